@@ -0,0 +1,302 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+#include <numeric>
+#include <algorithm>
+#include <new>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/** The outcome of a task run in a child process */
+enum class TaskStatus {
+	completed,
+	timed_out,			///< the task was killed after exceeding the wall-clock limit
+	out_of_memory,	///< the task exceeded the memory limit
+	failed					///< the task threw an exception or was killed by a signal
+};
+
+inline std::string to_string(TaskStatus status) {
+	switch (status) {
+		case TaskStatus::completed: return "completed";
+		case TaskStatus::timed_out: return "timed_out";
+		case TaskStatus::out_of_memory: return "out_of_memory";
+		default: return "failed";
+	}
+}
+
+inline TaskStatus task_status_from_string(const std::string& status) {
+	if (status=="completed") return TaskStatus::completed;
+	if (status=="timed_out") return TaskStatus::timed_out;
+	if (status=="out_of_memory") return TaskStatus::out_of_memory;
+	return TaskStatus::failed;
+}
+
+/** Resource limits applied to each child process; zero means no limit */
+struct ResourceLimits {
+	int timeout_seconds=0;		///< wall-clock limit
+	long memory_megabytes=0;	///< limit on the address space
+};
+
+/** Write a string to a file descriptor, retrying after interruptions; errors are ignored */
+inline void write_all(int fd, const std::string& data) {
+	const char* p=data.data();
+	size_t left=data.size();
+	while (left) {
+		auto written=::write(fd,p,left);
+		if (written<0 && errno==EINTR) continue;
+		if (written<0) return;
+		p+=written; left-=written;
+	}
+}
+
+/** The exit status of a child process that ran out of memory */
+constexpr int exit_out_of_memory=3;
+
+/** Limit the address space of the current process, if limits.memory_megabytes is positive */
+inline void apply_memory_limit(const ResourceLimits& limits) {
+	if (!limits.memory_megabytes) return;
+	rlimit limit;
+	limit.rlim_cur=limit.rlim_max=static_cast<rlim_t>(limits.memory_megabytes)*1024*1024;
+	setrlimit(RLIMIT_AS,&limit);
+}
+
+/** Return the outcome of a task from the status of the child process that ran it, as returned by waitpid
+	@param status The status
+	@param killed True if the child was killed for exceeding the wall-clock limit
+*/
+inline TaskStatus task_status(int status, bool killed) {
+	if (killed) return TaskStatus::timed_out;
+	if (WIFEXITED(status) && WEXITSTATUS(status)==0) return TaskStatus::completed;
+	if (WIFEXITED(status) && WEXITSTATUS(status)==exit_out_of_memory) return TaskStatus::out_of_memory;
+	return TaskStatus::failed;
+}
+
+/** Callbacks invoked in the parent process while an OrderedProcessPool runs, to monitor its progress */
+class PoolMonitor {
+public:
+	virtual ~PoolMonitor()=default;
+/** Invoked when a task is started in a child process */
+	virtual void started(int index) {}
+/** Invoked as soon as the child running a task terminates, before the output is handed to the consumer */
+	virtual void finished(int index, TaskStatus status) {}
+/** Invoked periodically, also while no task starts or terminates */
+	virtual void tick() {}
+};
+
+/** Runs a sequence of tasks in child processes, at most a fixed number at a time, and hands their output to a consumer in the order of the tasks.
+
+	GiNaC and Wedge are not thread-safe, so each task runs in a forked copy of the process; any data built before calling run(), such as a classification, is shared with the children. Each child is subject to the given resource limits, so that a task that hangs or exhausts memory is reported as such without affecting the other tasks.
+*/
+class OrderedProcessPool {
+	using Clock=std::chrono::steady_clock;
+	struct Child {
+		pid_t pid;
+		int fd;
+		int position;
+		int index;
+		Clock::time_point deadline;
+		bool killed;
+		std::string output;
+	};
+	int jobs;
+	ResourceLimits limits;
+	std::vector<Child> running;
+	struct Result {
+		int index;
+		TaskStatus status;
+		std::string output;
+	};
+	std::map<int,Result> completed;		///< tasks that have completed but have not been handed to the consumer yet, indexed by position
+	PoolMonitor* monitor=nullptr;
+	std::chrono::milliseconds tick_interval{0};
+	Clock::time_point next_tick=Clock::time_point::max();
+
+	template<typename Task> void spawn(int position, int index, Task& task) {
+		int fds[2];
+		if (pipe(fds)) throw std::runtime_error("cannot create pipe");
+		std::cout.flush(); std::cerr.flush();
+		pid_t pid=fork();
+		if (pid<0) throw std::runtime_error("cannot fork");
+		if (!pid) {
+			close(fds[0]);
+			apply_memory_limit(limits);
+			int status=0;
+			try {write_all(fds[1],task(index));}
+			catch (const std::bad_alloc&) {status=exit_out_of_memory;}
+			catch (const std::exception& e) {
+				std::cerr<<"entry "<<index+1<<": "<<e.what()<<std::endl;
+				status=1;
+			}
+			close(fds[1]);
+			_exit(status);
+		}
+		close(fds[1]);
+		auto deadline=limits.timeout_seconds? Clock::now()+std::chrono::seconds(limits.timeout_seconds) : Clock::time_point::max();
+		running.push_back(Child{pid,fds[0],position,index,deadline,false,{}});
+		if (monitor) monitor->started(index);
+	}
+	TaskStatus reap(Child& child) {
+		close(child.fd);
+		int status=0;
+		while (waitpid(child.pid,&status,0)<0 && errno==EINTR);
+		return task_status(status,child.killed);
+	}
+	int milliseconds_to_next_deadline() const {
+		auto deadline=next_tick;
+		for (auto& child: running)
+			if (!child.killed && child.deadline<deadline) deadline=child.deadline;
+		if (deadline==Clock::time_point::max()) return -1;
+		auto left=std::chrono::duration_cast<std::chrono::milliseconds>(deadline-Clock::now()).count();
+		return left>0? left+1 : 0;
+	}
+	void kill_expired() {
+		auto now=Clock::now();
+		for (auto& child: running)
+			if (!child.killed && child.deadline<=now) {
+				kill(child.pid,SIGKILL);
+				child.killed=true;
+			}
+	}
+	std::vector<int> wait_for_output() {		//returns the positions of the tasks that completed
+		std::vector<int> positions;
+		std::vector<pollfd> fds;
+		for (auto& child: running) fds.push_back(pollfd{child.fd,POLLIN,0});
+		if (poll(fds.data(),fds.size(),milliseconds_to_next_deadline())<0) {
+			if (errno==EINTR) return positions;
+			throw std::runtime_error("poll failed");
+		}
+		kill_expired();
+		if (monitor && Clock::now()>=next_tick) {
+			monitor->tick();
+			next_tick=Clock::now()+tick_interval;
+		}
+		for (int i=fds.size()-1;i>=0;--i) {
+			if (!fds[i].revents) continue;
+			auto& child=running[i];
+			char buffer[65536];
+			auto bytes=read(child.fd,buffer,sizeof(buffer));
+			if (bytes>0) child.output.append(buffer,bytes);
+			else if (bytes==0 || errno!=EINTR) {
+				auto status=reap(child);
+				if (monitor) monitor->finished(child.index,status);
+				completed.emplace(child.position,Result{child.index,status,std::move(child.output)});
+				positions.push_back(child.position);
+				running.erase(running.begin()+i);
+			}
+		}
+		return positions;
+	}
+public:
+	explicit OrderedProcessPool(int jobs, ResourceLimits limits={}) : jobs{jobs}, limits{limits} {}
+/** Set an object to be notified of the progress of the tasks
+	@param monitor The object, or nullptr
+	@param interval The interval between consecutive invocations of monitor->tick()
+*/
+	void set_monitor(PoolMonitor* monitor, std::chrono::milliseconds interval) {
+		this->monitor=monitor;
+		tick_interval=interval;
+		next_tick=monitor? Clock::now()+interval : Clock::time_point::max();
+	}
+
+/** Run a sequence of tasks produced on demand
+	@param next_task A callable object returning the index of the next task as an optional<int>, or nothing when there are no more tasks; it is invoked in the parent process only when a task can be started, so that the tasks can be read from a stream
+	@param skip A callable object taking an int and returning true if the task need not be run; such tasks are handed to the consumer in their order with status completed and an empty output, without starting a child
+	@param task A callable object taking an int and returning the output of the corresponding task as a string; it is invoked in a child process
+	@param consumer A callable object taking an int, a TaskStatus and a const string&; it is invoked in the parent process on each task, in the order in which the tasks were produced. If the task did not complete, the output is what the child wrote before being terminated
+
+	At most 2*jobs tasks are held at any time, counting those that are running and those that have completed but wait for an earlier task to complete, so that memory usage does not depend on the number of tasks.
+*/
+	template<typename Source, typename Skip, typename Task, typename Consumer> void run_stream(Source&& next_task, Skip&& skip, Task&& task, Consumer&& consumer) {
+		int next_to_start=0, next_to_emit=0;
+		bool exhausted=false;
+		while (true) {
+			while (!exhausted && running.size()<jobs && running.size()+completed.size()<2*jobs) {
+				auto index=next_task();
+				if (!index) exhausted=true;
+				else if (skip(*index)) completed.emplace(next_to_start++,Result{*index,TaskStatus::completed,{}});
+				else spawn(next_to_start++,*index,task);
+			}
+			if (next_to_emit==next_to_start && exhausted) break;
+			if (!running.empty()) wait_for_output();
+			for (auto i=completed.begin();i!=completed.end() && i->first==next_to_emit;i=completed.erase(i),++next_to_emit)
+				consumer(i->second.index,i->second.status,i->second.output);
+		}
+	}
+/** Run a sequence of tasks produced on demand, @sa run_stream */
+	template<typename Source, typename Task, typename Consumer> void run_stream(Source&& next_task, Task&& task, Consumer&& consumer) {
+		run_stream(std::forward<Source>(next_task),[] (int) {return false;},std::forward<Task>(task),std::forward<Consumer>(consumer));
+	}
+/** Run a list of tasks
+	@param tasks The indices of the tasks to run
+	@param task A callable object taking an int and returning the output of the corresponding task as a string; it is invoked in a child process
+	@param consumer A callable object taking an int, a TaskStatus and a const string&; it is invoked in the parent process on each task, in the order of the list. If the task did not complete, the output is what the child wrote before being terminated
+*/
+	template<typename Task, typename Consumer> void run(const std::vector<int>& tasks, Task&& task, Consumer&& consumer) {
+		auto next=tasks.begin();
+		run_stream([&next,&tasks] () {return next==tasks.end()? std::optional<int>{} : std::optional<int>{*next++};},std::forward<Task>(task),std::forward<Consumer>(consumer));
+	}
+/** Run a list of tasks, starting the most expensive ones first
+	@param tasks The indices of the tasks to run
+	@param costs The estimated cost of each task, in the order of tasks
+	@param task A callable object taking an int and returning the output of the corresponding task as a string; it is invoked in a child process
+	@param journal A callable object taking an int, a TaskStatus and a const string&; it is invoked in the parent process on each task as soon as it completes, in no particular order
+	@param consumer A callable object taking an int, a TaskStatus and a const string&; it is invoked in the parent process on each task, in the order of the list
+
+	Tasks are started in order of decreasing cost, breaking ties by position, whenever fewer than jobs tasks are running, so that each worker takes the most expensive task left as soon as it is free, and the run ends shortly after the most expensive task rather than with a single worker busy on a task started last. Outputs that cannot be handed to the consumer yet are held in memory, so that memory usage grows with the number of tasks.
+*/
+	template<typename Task, typename Journal, typename Consumer> void run_by_cost(const std::vector<int>& tasks, const std::vector<double>& costs, Task&& task, Journal&& journal, Consumer&& consumer) {
+		std::vector<int> order(tasks.size());
+		std::iota(order.begin(),order.end(),0);
+		std::stable_sort(order.begin(),order.end(),[&costs] (int i, int j) {return costs[i]>costs[j];});
+		int next_to_start=0, next_to_emit=0;
+		while (next_to_emit<tasks.size()) {
+			while (next_to_start<order.size() && running.size()<jobs) {
+				int position=order[next_to_start++];
+				spawn(position,tasks[position],task);
+			}
+			for (int position: wait_for_output()) {
+				auto& result=completed.at(position);
+				journal(result.index,result.status,result.output);
+			}
+			for (auto i=completed.begin();i!=completed.end() && i->first==next_to_emit;i=completed.erase(i),++next_to_emit)
+				consumer(i->second.index,i->second.status,i->second.output);
+		}
+	}
+/** Run the tasks 0,...,ntasks-1, @sa run */
+	template<typename Task, typename Consumer> void run(int ntasks, Task&& task, Consumer&& consumer) {
+		std::vector<int> tasks;
+		for (int i=0;i<ntasks;++i) tasks.push_back(i);
+		run(tasks,std::forward<Task>(task),std::forward<Consumer>(consumer));
+	}
+};
+
+#endif
@@ -0,0 +1,245 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Benchmark the stages of the computation performed by gleipnir over a list of Lie algebras.
+
+	Each Lie algebra is processed in a child process, whose peak resident set size is reset when it starts, so that it refers to that Lie algebra alone, @sa reset_peak_rss.
+*/
+
+#include <chrono>
+#include <fstream>
+#include "nice.h"
+#include "classification.h"
+#include "options.h"
+#include "batch.h"
+#include "json.h"
+#include "telemetry.h"
+
+struct BenchOptions {
+	int repetitions=3;
+	bool json=false;
+	string input;					///< file containing the Lie algebras to benchmark, @sa ClassificationFile; if empty, the classification is used
+	string baseline;			///< file containing the CSV output of a previous run
+	int threshold=20;			///< percentage of slowdown with respect to the baseline that is reported as a regression
+	double noise_floor_ms=1;	///< slowdowns smaller than this are never reported
+};
+
+string bench_usage() {
+	return
+		"usage: gleipnir_bench [options]\n"
+		"  --repetitions N   time each stage N times and report the median (default 3)\n"
+		"  --format csv|json output format (default csv)\n"
+		"  --input FILE      benchmark the Lie algebras in FILE, one per line, instead of the classification\n"
+		"  --baseline FILE   compare with the CSV output of a previous run, and report regressions\n"
+		"  --threshold P     report stages that are more than P percent slower than the baseline (default 20)\n";
+}
+
+BenchOptions parse_bench_options(int argc, char** argv) {
+	BenchOptions options;
+	for (int i=1;i<argc;++i) {
+		string arg=argv[i];
+		auto value=[&] () -> string {
+			if (++i==argc) throw invalid_argument(arg+" expects an argument");
+			return argv[i];
+		};
+		if (arg=="--repetitions") options.repetitions=positive_integer(arg,value());
+		else if (arg=="--format") {
+			auto format=value();
+			if (format!="csv" && format!="json") throw invalid_argument("unknown format "+format);
+			options.json=format=="json";
+		}
+		else if (arg=="--input") options.input=value();
+		else if (arg=="--baseline") options.baseline=value();
+		else if (arg=="--threshold") options.threshold=positive_integer(arg,value());
+		else throw invalid_argument("unknown option "+arg);
+	}
+	return options;
+}
+
+/** The timings of one stage, in milliseconds */
+struct StageTiming {
+	string stage;
+	double median, min, max;
+};
+
+/** The timings of all stages for one Lie algebra */
+struct AlgebraTiming {
+	string name;
+	string structure_constants;
+	long peak_rss_kb=0;
+	vector<StageTiming> stages;
+};
+
+/** Collects the running times of the stages over repetitions */
+class StageTimer {
+	using Clock=std::chrono::steady_clock;
+	vector<string> stages;
+	map<string,vector<double>> times;
+public:
+	template<typename Function> auto time(const string& stage, Function&& function) {
+		if (!times.count(stage)) stages.push_back(stage);
+		auto start=Clock::now();
+		auto result=function();
+		times[stage].push_back(std::chrono::duration<double,std::milli>(Clock::now()-start).count());
+		return result;
+	}
+	vector<StageTiming> timings() const {
+		vector<StageTiming> result;
+		for (auto& stage: stages) {
+			auto t=times.at(stage);
+			sort(t.begin(),t.end());
+			auto median=t.size()%2? t[t.size()/2] : (t[t.size()/2-1]+t[t.size()/2])/2;
+			result.push_back({stage,median,t.front(),t.back()});
+		}
+		return result;
+	}
+};
+
+/** Run the stages of study_group on a Lie group, as in gleipnir
+	@return A text representation of the timings, one stage per line, followed by the peak resident set size in kilobytes
+*/
+string benchmark(const LieGroup& G, int repetitions) {
+	reset_peak_rss();		//the child inherits the high-water mark of the parent
+	StageTimer timer;
+	for (int i=0;i<repetitions;++i) {
+		auto gl=timer.time("gl",[&G] () {return make_unique<GL>(G.Dimension());});
+		auto c=timer.time("structure_constants",[&G] () {return StructureConstants{G};});
+		auto derivations=timer.time("derivations_parametric",[&] () {return derivations_parametric<StructureConstant>(G,c,*gl);});
+		VectorSpace<DifferentialForm> der{derivations.basis_of_larger_space};
+		auto form=timer.time("trace_form",[&] () {return trace_form(der,derivations.basis_of_smaller_space,*gl);});
+		auto eqns=timer.time("nikolayevsky_equations",[&] () {return nikolayevsky_equations(form);});
+		auto nik_like_derivations=timer.time("get_solutions",[&] () {return solve_nikolayevsky_equations(form,eqns);});
+		timer.time("root_matrix",[&] () {
+			auto diagonal=nice_nikolayevsky(c);
+			return diagonal? nice_nikolayevsky_like_derivations(form,*diagonal) : nullopt;
+		});
+		timer.time("derivation_when",[&] () {return derivation_when(G,c,*gl,nik_like_derivations.N);});
+		timer.time("centralizer",[&] () {return centralizer(nik_like_derivations);});
+		timer.time("print_derivations",[&] () {stringstream s; return print_derivations(G,c,*gl,s);});
+	}
+	stringstream result;
+	for (auto& timing: timer.timings())
+		result<<timing.stage<<' '<<timing.median<<' '<<timing.min<<' '<<timing.max<<'\n';
+	result<<"peak_rss_kb "<<peak_rss_kilobytes()<<'\n';
+	return result.str();
+}
+
+/** Parse the output of benchmark */
+void parse_timings(const string& output, AlgebraTiming& timing) {
+	stringstream s{output};
+	string stage;
+	while (s>>stage) {
+		if (stage=="peak_rss_kb") s>>timing.peak_rss_kb;
+		else {
+			StageTiming stage_timing{stage};
+			s>>stage_timing.median>>stage_timing.min>>stage_timing.max;
+			timing.stages.push_back(stage_timing);
+		}
+	}
+}
+
+void print_csv(ostream& os, const vector<AlgebraTiming>& timings) {
+	os<<"name,stage,median_ms,min_ms,max_ms,peak_rss_kb\n";
+	for (auto& algebra: timings)
+		for (auto& stage: algebra.stages)
+			os<<algebra.name<<','<<stage.stage<<','<<stage.median<<','<<stage.min<<','<<stage.max<<','<<algebra.peak_rss_kb<<'\n';
+}
+
+void print_json(ostream& os, const vector<AlgebraTiming>& timings) {
+	os<<"[\n";
+	for (int i=0;i<timings.size();++i) {
+		auto& algebra=timings[i];
+		os<<"{\"name\":"<<json_string(algebra.name)<<",\"structure_constants\":"<<json_string(algebra.structure_constants)<<",\"peak_rss_kb\":"<<algebra.peak_rss_kb<<",\"stages\":{";
+		for (int j=0;j<algebra.stages.size();++j) {
+			auto& stage=algebra.stages[j];
+			os<<(j? ",":"")<<json_string(stage.stage)<<":{\"median_ms\":"<<stage.median<<",\"min_ms\":"<<stage.min<<",\"max_ms\":"<<stage.max<<"}";
+		}
+		os<<"}}"<<(i+1<timings.size()? ",":"")<<"\n";
+	}
+	os<<"]\n";
+}
+
+/** Read the medians from the CSV output of a previous run
+	@return A map from (name,stage) to the median time in milliseconds
+*/
+map<pair<string,string>,double> read_baseline(const string& path) {
+	ifstream file{path};
+	if (!file) throw runtime_error("cannot open baseline "+path);
+	map<pair<string,string>,double> result;
+	string line;
+	getline(file,line);
+	while (getline(file,line)) {
+		stringstream s{line};
+		string name, stage, median;
+		if (getline(s,name,',') && getline(s,stage,',') && getline(s,median,','))
+			result[{name,stage}]=stod(median);
+	}
+	return result;
+}
+
+/** Print the stages that are slower than the baseline by more than the threshold
+	@return The number of regressions
+*/
+int compare_with_baseline(const vector<AlgebraTiming>& timings, const BenchOptions& options) {
+	auto baseline=read_baseline(options.baseline);
+	int regressions=0;
+	for (auto& algebra: timings)
+		for (auto& stage: algebra.stages) {
+			auto i=baseline.find({algebra.name,stage.stage});
+			if (i==baseline.end()) continue;
+			if (stage.median>i->second*(1+options.threshold/100.0) && stage.median-i->second>options.noise_floor_ms) {
+				cerr<<"regression: "<<algebra.name<<" "<<stage.stage<<" "<<i->second<<" ms -> "<<stage.median<<" ms"<<endl;
+				++regressions;
+			}
+		}
+	return regressions;
+}
+
+int main(int argc, char** argv) {
+	try {
+		auto options=parse_bench_options(argc,argv);
+		unique_ptr<Classification<LieGroup>> classification;
+		if (options.input.empty()) classification=make_unique<NilpotentLieGroups7>();
+		else classification=make_unique<ClassificationFile>(options.input);
+		auto& algebras=*classification;
+		vector<AlgebraTiming> timings;
+		OrderedProcessPool pool{1};
+		pool.run(algebras.size(),
+			[&algebras,&options] (int i) {return benchmark(algebras.entry(OneBased{i+1}),options.repetitions);},
+			[&algebras,&timings] (int i, TaskStatus status, const string& output) {
+				AlgebraTiming timing;
+				timing.name=algebras.name(OneBased{i+1});
+				timing.structure_constants=horizontal(algebras.entry(OneBased{i+1}).StructureConstants());
+				if (status==TaskStatus::completed) parse_timings(output,timing);
+				else cerr<<"entry "<<timing.name<<" "<<to_string(status)<<endl;
+				timings.push_back(move(timing));
+			}
+		);
+		if (options.json) print_json(cout,timings);
+		else print_csv(cout,timings);
+		if (!options.baseline.empty() && compare_with_baseline(timings,options)) return 2;
+	}
+	catch (const invalid_argument& e) {
+		cerr<<e.what()<<endl<<bench_usage();
+		return 1;
+	}
+	catch (const runtime_error& e) {
+		cerr<<e.what()<<endl;
+		return 1;
+	}
+}
@@ -0,0 +1,91 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "record.h"
+
+#ifndef GLEIPNIR_VERSION
+#define GLEIPNIR_VERSION "unknown"
+#endif
+
+/** Return the 64-bit FNV-1a hash of a string, in hexadecimal notation */
+inline std::string fnv1a_hash(const std::string& s) {
+	uint64_t hash=14695981039346656037ull;
+	for (unsigned char c: s) {
+		hash^=c;
+		hash*=1099511628211ull;
+	}
+	static const char digits[]="0123456789abcdef";
+	std::string result(16,'0');
+	for (int i=15;i>=0;--i,hash>>=4) result[i]=digits[hash&15];
+	return result;
+}
+
+/** A persistent cache of results, stored in a directory as one file per Lie algebra.
+
+	Files are named after a hash of the program version and the normal form of the structure constants; both are also stored in the file and checked on loading, so that hash collisions and results computed by a different version of Gleipnir are never returned. Files are written to a temporary name and then renamed, so that several processes can share the same cache.
+*/
+class ResultCache {
+	std::string directory;
+	std::string path(const std::string& normal_form) const {
+		return directory+"/"+fnv1a_hash(std::string{GLEIPNIR_VERSION}+'\n'+normal_form);
+	}
+public:
+/** Open a cache, creating the directory if it does not exist
+	@param directory The directory containing the cache
+	@exception std::runtime_error if the directory cannot be created
+*/
+	explicit ResultCache(const std::string& directory) : directory{directory} {
+		if (mkdir(directory.c_str(),0777) && errno!=EEXIST) throw std::runtime_error("cannot create cache directory "+directory);
+	}
+/** Look up the results for a Lie algebra
+	@param normal_form The normal form of the structure constants of the Lie algebra
+	@return The stored results, or nothing if the Lie algebra is not in the cache
+*/
+	std::optional<StudyRecord> load(const std::string& normal_form) const {
+		std::ifstream file{path(normal_form),std::ios::binary};
+		std::string version;
+		StudyRecord record;
+		if (!getline(file,version) || version!=GLEIPNIR_VERSION || !read(file,record) || record.structure_constants!=normal_form) return std::nullopt;
+		return record;
+	}
+/** Store the results for a Lie algebra, identified by the structure_constants field of the record */
+	void store(const StudyRecord& record) const {
+		auto destination=path(record.structure_constants);
+		auto temporary=destination+"."+std::to_string(getpid());
+		std::ofstream file{temporary,std::ios::binary};
+		file<<GLEIPNIR_VERSION<<'\n';
+		write(file,record);
+		file.close();
+		if (file) std::rename(temporary.c_str(),destination.c_str());
+		else std::remove(temporary.c_str());
+	}
+};
+
+#endif
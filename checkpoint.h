@@ -0,0 +1,76 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <stdexcept>
+#include "batch.h"
+
+/** An entry of a sweep that has been processed */
+struct JournalEntry {
+	TaskStatus status;
+	std::string output;
+};
+
+/** A journal of the processed entries of a sweep, used to resume an interrupted run.
+
+	Each entry is appended as a line containing its zero-based index, its status and the length of its output, followed by the output and a newline, and flushed immediately; a truncated last entry, as left by a run that was killed while writing, is ignored.
+*/
+class Checkpoint {
+	std::map<int,JournalEntry> entries;
+	std::ofstream journal;
+	void load(const std::string& path) {
+		std::ifstream file{path,std::ios::binary};
+		int index;
+		std::string status;
+		size_t size;
+		while (file>>index>>status>>size && file.get()=='\n') {
+			std::string output(size,'\0');
+			if (!file.read(&output[0],size) || file.get()!='\n') break;
+			entries[index]=JournalEntry{task_status_from_string(status),std::move(output)};
+		}
+	}
+public:
+/** Open a checkpoint file
+	@param path The name of the file
+	@param resume If true, the entries already in the file are loaded and kept in the journal; otherwise, the file is truncated
+	@exception std::runtime_error if the file cannot be opened
+*/
+	Checkpoint(const std::string& path, bool resume) {
+		if (resume) load(path);
+		journal.open(path,std::ios::binary | std::ios::trunc);
+		if (!journal) throw std::runtime_error("cannot open checkpoint file "+path);
+		for (auto& entry: entries) write(entry.first,entry.second);		//rewriting the loaded entries drops a truncated last entry
+	}
+/** The entries processed by previous runs */
+	const std::map<int,JournalEntry>& processed() const {return entries;}
+/** Append an entry to the journal */
+	void record(int index, TaskStatus status, const std::string& output) {
+		write(index,JournalEntry{status,output});
+	}
+private:
+	void write(int index, const JournalEntry& entry) {
+		journal<<index<<' '<<to_string(entry.status)<<' '<<entry.output.size()<<'\n'<<entry.output<<'\n'<<std::flush;
+	}
+};
+
+#endif
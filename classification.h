@@ -20,260 +20,442 @@
 #define CLASSIFICATION_H
 
 #include <wedge/wedge.h>
+#include <string_view>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 using namespace Wedge;
 using std::string;
 
-/** Represents an immutable list of mathematical objects corresponding to a classification */
+/** Represents an immutable list of mathematical objects corresponding to a classification
+
+	Each entry is stored as a textual description, and only constructed when accessed; at most one constructed entry is kept in memory, so that the size of a classification does not affect the memory usage or the time needed to access a single entry.
+*/
 template <typename Classified> class Classification {
-	vector<unique_ptr<Classified>> elements;
+	vector<std::string_view> descriptions;
 	vector<string> names;
+	std::unordered_map<string,int> index_of_name;
+	mutable int constructed_index=0;
+	mutable unique_ptr<Classified> constructed;
 protected:
-/** Add an entry to the classification
+/** Construct an entry from its description */
+	virtual unique_ptr<Classified> construct(std::string_view description) const=0;
+/** Add an entry to the classification, named after its one-based position
 
- @param element The entry to be added. Ownership is transferred to this container
+ @param description The description of the entry, which must remain valid for the lifetime of this object
 */
-	void add (unique_ptr<Classified>&& element) {elements.emplace_back(move(element)); names.push_back(ToString(elements.size()));}
+	void add (std::string_view description) {add(description,ToString(descriptions.size()+1));}
 /** Add an entry to the classification
 
- @param element The entry to be added. Ownership is transferred to this container
+ @param description The description of the entry, which must remain valid for the lifetime of this object
  @param name A name for this entry
 */
-	void add (unique_ptr<Classified>&& element, string name) {elements.push_back(move(element)); names.push_back(name);}
+	void add (std::string_view description, string name) {
+		descriptions.push_back(description); 
+		index_of_name.emplace(name,descriptions.size());
+		names.push_back(move(name));
+	}
 	Classification() {}
 public:
-	template<typename T> Classification(std::initializer_list<T> args_for_elems) {
-		for (auto& args: args_for_elems)
-			elements.emplace_back(args);
+	Classification(const Classification&)=delete;
+	virtual ~Classification()=default;
+/** Return an entry of the classification, constructing it if needed
+	@param index The position of the entry
+	@return A reference to the entry, which remains valid until entry() is called with a different index
+*/
+	const Classified& entry (OneBased index) const {
+		if (index!=constructed_index || !constructed) {
+			constructed.reset();
+			constructed=construct(descriptions[index-1]);
+			constructed_index=index;
+		}
+		return *constructed;
+	}
+	std::string_view description (OneBased index) const {return descriptions[index-1];}
+	const string& name (OneBased index) const {return names[index-1];}
+/** Return the one-based position of the entry with a given name, or 0 if there is no such entry */
+	int find(const string& name) const {
+		auto i=index_of_name.find(name);
+		return i==index_of_name.end()? 0 : i->second;
+	}
+	int size() const {return descriptions.size();}
+};
+
+/** Return the name of a parameter of a family of Lie groups; lambda is the one used in the classifications below */
+inline Name parameter_name(const string& name) {
+	return name=="lambda"? N.lambda : Name{name};
+}
+
+/** Parse a Lie group from a line of text
+	@param line The structure constants, in the syntax accepted by AbstractLieGroup, optionally followed by a semicolon and a comma-separated list of the parameters appearing in square brackets, e.g. "0,0,12,13,[lambda]*14+23; lambda"
+	@return The Lie group
+	@exception std::invalid_argument if more than three parameters are declared
+*/
+inline unique_ptr<LieGroup> lie_group_from_string(const string& line) {
+	auto semicolon=line.find(';');
+	string structure_constants=line.substr(0,semicolon);
+	vector<Name> parameters;
+	if (semicolon!=string::npos) {
+		stringstream s{line.substr(semicolon+1)};
+		string name;
+		while (getline(s,name,',')) {
+			name.erase(0,name.find_first_not_of(" \t"));
+			name.erase(name.find_last_not_of(" \t\r")+1);
+			if (!name.empty()) parameters.push_back(parameter_name(name));
+		}
+	}
+	switch (parameters.size()) {
+		case 0: return make_unique<AbstractLieGroup<false>>(structure_constants.c_str());
+		case 1: return make_unique<AbstractLieGroup<true>>(structure_constants.c_str(),parameters[0]);
+		case 2: return make_unique<AbstractLieGroup<true>>(structure_constants.c_str(),parameters[0],parameters[1]);
+		case 3: return make_unique<AbstractLieGroup<true>>(structure_constants.c_str(),parameters[0],parameters[1],parameters[2]);
+		default: throw std::invalid_argument("at most three parameters are supported: "+line);
 	}
+}
 
-	const Classified& entry (OneBased index) {return *elements[index-1];}
-	const string& name (OneBased index) {return names[index-1];}
-	auto begin() const {return elements.begin();}
-	auto end() const {return elements.end();}
+/** Read the next Lie group from a stream containing one Lie group per line, in the format accepted by lie_group_from_string; empty lines and lines starting with # are skipped
+	@param is The stream
+	@param line Set to the line containing the Lie group
+	@return true if a line was read, false at the end of the stream
+*/
+inline bool next_lie_group_line(istream& is, string& line) {
+	while (getline(is,line))
+		if (line.find_first_not_of(" \t\r")!=string::npos && line[line.find_first_not_of(" \t")]!='#') return true;
+	return false;
+}
+
+/** A classification of Lie groups, whose entries are described in the format accepted by lie_group_from_string */
+class LieGroupClassification : public Classification<LieGroup> {
+protected:
+	unique_ptr<LieGroup> construct(std::string_view description) const override {
+		return lie_group_from_string(string{description});
+	}
 };
 
-/* Nilpotent Lie groups of dimension 7, as classified by 
-	M.P. Gong. {Classification of nilpotent Lie algebras of dimension 7 (over algebraically closed fields and R),Thesis (Ph.D.)--University of Waterloo (Canada), 1998.
+/** A read-only memory mapping of a file */
+class MappedFile {
+	const char* data_=nullptr;
+	size_t size_=0;
+public:
+/** Map a file in memory
+	@exception std::runtime_error if the file cannot be opened or mapped
 */
+	explicit MappedFile(const string& path) {
+		int fd=open(path.c_str(),O_RDONLY);
+		if (fd<0) throw std::runtime_error("cannot open "+path);
+		struct stat status;
+		if (fstat(fd,&status)<0) {
+			close(fd);
+			throw std::runtime_error("cannot read "+path);
+		}
+		size_=status.st_size;
+		if (size_) {
+			void* mapping=mmap(nullptr,size_,PROT_READ,MAP_PRIVATE,fd,0);
+			if (mapping==MAP_FAILED) {
+				close(fd);
+				throw std::runtime_error("cannot map "+path);
+			}
+			data_=static_cast<const char*>(mapping);
+		}
+		close(fd);
+	}
+	MappedFile(const MappedFile&)=delete;
+	~MappedFile() {if (data_) munmap(const_cast<char*>(data_),size_);}
+	std::string_view contents() const {return {data_,size_};}
+};
 
-class NilpotentLieGroups7 : public Classification<LieGroup> {
-	void add(const char* structure_constants) {
-		Classification<LieGroup>::add(make_unique<AbstractLieGroup<false>>	(structure_constants));
+/** A classification of Lie groups read from a data file
+
+	The file contains one entry per line, in the format accepted by lie_group_from_string, optionally preceded by a name and a colon, e.g.
+	
+		N1: 0,0,12,13,[lambda]*14+23; lambda
+	
+	Empty lines and lines starting with # are ignored; entries without a name are named after their one-based position. The file is mapped in memory and only split into lines when it is loaded, so that loading does not depend on the complexity of the entries, @sa Classification.
+*/
+class ClassificationFile : public LieGroupClassification {
+	MappedFile file;
+	static std::string_view trim(std::string_view s) {
+		auto begin=s.find_first_not_of(" \t\r");
+		if (begin==std::string_view::npos) return {};
+		return s.substr(begin,s.find_last_not_of(" \t\r")-begin+1);
 	}
-	template <typename... T>
-	void add(const char* structure_constants, const T&... names) {
-		Classification<LieGroup>::add(make_unique<AbstractLieGroup<true>>	(structure_constants, names...));
+public:
+/** Load a classification from a file
+	@exception std::runtime_error if the file cannot be read
+	@exception std::invalid_argument if two entries have the same name
+*/
+	explicit ClassificationFile(const string& path) : file{path} {
+		auto contents=file.contents();
+		while (!contents.empty()) {
+			auto newline=contents.find('\n');
+			auto line=trim(contents.substr(0,newline));
+			contents.remove_prefix(newline==std::string_view::npos? contents.size() : newline+1);
+			if (line.empty() || line[0]=='#') continue;
+			auto colon=line.find(':');
+			if (colon==std::string_view::npos) add(line);
+			else {
+				string name{trim(line.substr(0,colon))};
+				if (find(name)) throw std::invalid_argument("duplicate entry "+name+" in "+path);
+				add(trim(line.substr(colon+1)),name);
+			}
+		}
 	}
+};
+
+/** Parse a selection of entries of a classification
+	@param classification A classification
+	@param selection A comma-separated list of items, each of which is a one-based position, a range of positions such as 140-150, or the name of an entry
+	@return The zero-based positions of the selected entries, in increasing order and without repetitions
+	@exception std::invalid_argument if an item does not identify entries of the classification, or is a range whose first position exceeds the last
+
+	An item is taken as a name whenever some entry has that name, and as a position or a range otherwise, so that names such as 12 or 3-5 take precedence over positions.
+*/
+template<typename Classified> vector<int> select_entries(const Classification<Classified>& classification, const string& selection) {
+	auto position=[&classification] (const string& item) {
+		size_t end=0;
+		int result=0;
+		try {result=std::stoi(item,&end);}
+		catch (const std::exception&) {end=0;}
+		if (end!=item.size()) result=0;
+		if (result<1 || result>classification.size()) throw std::invalid_argument("no entry "+item+" in the classification");
+		return result;
+	};
+	std::set<int> selected;
+	stringstream s{selection};
+	string item;
+	while (getline(s,item,',')) {
+		if (int i=classification.find(item)) {selected.insert(i-1); continue;}
+		auto dash=item.find('-',1);
+		if (dash==string::npos) selected.insert(position(item)-1);
+		else {
+			int first=position(item.substr(0,dash)), last=position(item.substr(dash+1));
+			if (first>last) throw std::invalid_argument("empty range "+item);
+			for (int i=first;i<=last;++i) selected.insert(i-1);
+		}
+	}
+	return {selected.begin(),selected.end()};
+}
+
+/* Nilpotent Lie groups of dimension 7, as classified by 
+	M.P. Gong. {Classification of nilpotent Lie algebras of dimension 7 (over algebraically closed fields and R),Thesis (Ph.D.)--University of Waterloo (Canada), 1998.
+*/
+
+class NilpotentLieGroups7 : public LieGroupClassification {
 public:
 	NilpotentLieGroups7() {
-		//reducible, 3+4
-		add("0, 0, 0, 0, 12, 34, 36");
-		//reducible, 6+1
-		add("0, 0, 12, 13, 23, 14, 0");
-		add("0, 0, 12, 13, 23, 14 + 25, 0");
-		add("0, 0, 12, 13,23, 14 - 25, 0");
-		add("0,0,12,13,14+23,24+15, 0");
-		add("0, 0, 0, 12, 14, 15 + 23, 0");
-		add("0, 0, 0, 12, 14 - 23, 15 + 34, 0");
-		add("0, 0, 0, 12, 14, 15, 0");
-		add("0, 0, 0, 12, 23, 14 + 35, 0");
-		add("0, 0, 0, 12, 23, 14 - 35, 0");
-		add("0, 0, 0, 12, 13, 14 + 35, 0");
-		add("0, 0, 0, 12, 13, 14 + 23, 0");
-		add("0, 0, 0, 12, 13, 24, 0");    
-		add("0, 0, 0, 12, 13, 23, 0");    
-		add("0, 0, 0, 12, 14, 15 + 24, 0");
-		add("0, 0, 0, 12, 14, 15+ 23+ 24, 0");
-		add("0, 0, 0, 0, 12, 14 + 25, 0");
-		add("0, 0, 0, 0, 12, 15 + 34, 0");
-		add("0, 0, 0, 0, 13 + 42, 14 + 23, 0");
-		add("0, 0, 0, 0, 12, 14 + 23, 0");
-		add("0, 0, 0, 0, 12, 13, 0");
-		add("0, 0, 0, 0, 12, 34, 0");   
-		add("0, 0, 0, 0, 0, 12 + 34, 0");
-		add("0, 0, 0, 0, 0, 12, 0");
+		static const char* entries[]={
+			//reducible, 3+4
+			"0, 0, 0, 0, 12, 34, 36",
+			//reducible, 6+1
+			"0, 0, 12, 13, 23, 14, 0",
+			"0, 0, 12, 13, 23, 14 + 25, 0",
+			"0, 0, 12, 13,23, 14 - 25, 0",
+			"0,0,12,13,14+23,24+15, 0",
+			"0, 0, 0, 12, 14, 15 + 23, 0",
+			"0, 0, 0, 12, 14 - 23, 15 + 34, 0",
+			"0, 0, 0, 12, 14, 15, 0",
+			"0, 0, 0, 12, 23, 14 + 35, 0",
+			"0, 0, 0, 12, 23, 14 - 35, 0",
+			"0, 0, 0, 12, 13, 14 + 35, 0",
+			"0, 0, 0, 12, 13, 14 + 23, 0",
+			"0, 0, 0, 12, 13, 24, 0",
+			"0, 0, 0, 12, 13, 23, 0",
+			"0, 0, 0, 12, 14, 15 + 24, 0",
+			"0, 0, 0, 12, 14, 15+ 23+ 24, 0",
+			"0, 0, 0, 0, 12, 14 + 25, 0",
+			"0, 0, 0, 0, 12, 15 + 34, 0",
+			"0, 0, 0, 0, 13 + 42, 14 + 23, 0",
+			"0, 0, 0, 0, 12, 14 + 23, 0",
+			"0, 0, 0, 0, 12, 13, 0",
+			"0, 0, 0, 0, 12, 34, 0",
+			"0, 0, 0, 0, 0, 12 + 34, 0",
+			"0, 0, 0, 0, 0, 12, 0",
 	
-		add("0,0,12,13,14+23,34+52, 0");
-		add("0, 0, 12, 13, 14, 34 + 52, 0");
-
-		add("0, 0, 12, 13, 14, 15,0"); 
-		add("0,0,12,13,14,23+15,0");
-		add("0,0,0,12,14,24,0");
-		add("0,0,0,12,13+42,14+23,0");
-		add("0,0,0,12,14,13+42,0");
-		add("0,0,0,12,13+14,24,0");
-		add("0,0,0,12,13,14,0");
-		add("0,0,0,0,12,15,0");
-
-		//irreducible, step 2
-		add("0,0,0,0,12,23,24");
-		add("0,0,0,0,12,23,34");
-		add("0,0,0,0,12+34,23,24");
-		add("0,0,0,0,12+34,13,24");
-		add("0,0,0,0,0,12,14+35");
-		add("0,0,0,0,0,12+34,15+23");
-		add("0,0,0,0,0,0,12+34+56");
-		add("0,0,0,0,12-34,13+24,14");
-		add("0,0,0,0,12-34,13+24,14-23");
-
-		//irreducible, step 3
-		add("0,0,12,0,13,24,14");
-		add("0,0,12,0,13,23,14");
-		add("0,0,12,0,13+24,23,14");
-		add("0,0,12,0,0,13+24,15");
-		add("0,0,12,0,0,13,14+25");
-		add("0,0,12,0,0,13+24,25");
-		add("0,0,12,0,0,13+24,14+25");
-		add("0,0,12,0,0,13+45,24");
-		add("0,0,12,0,0,13+45,15+24");
-		add("0,0,12,0,0,13+24,45");
-		add("0,0,12,0,0,13+14,15+23");
-		add("0,0,12,0,0,13+24,15+23");
-		add("0,0,12,0,0,13,23+45");
-		add("0,0,12,0,0,13+24,23+45");
-		add("0,0,0,12,13,14,15");
-		add("0,0,0,12,13,14,35");
-		add("0,0,0,12,13,14+35,15");
-		add("0,0,0,12,13,14,25+34");
-		add("0,0,0,12,13,14+15,25+34");
-		add("0,0,0,12,13,24+35,25+34");
-		add("0,0,0,12,13,14+15+24+35,25+34");
-		add("0,0,0,12,13,14+24+35,25+34");
-		add("0,0,0,12,13,25+34,35");
-		add("0,0,0,12,13,15+35,25+34");
-		add("0,0,0,12,13,14+35,25+34");
-		add("0,0,0,12,13,14+23,15");
-		add("0,0,0,12,13,14+23,35");
-		add("0,0,0,12,13,15+24,23");
-		add("0,0,0,12,13,14+35,15+23");
-		add("0,0,0,12,13,23,25+34");
-		add("0,0,0,12,13,14+23,25+34");
-		add("0,0,0,12,13,14+15+23,25+34");
-		add("0,0,12,0,0,0,13+24+56");
+			"0,0,12,13,14+23,34+52, 0",
+			"0, 0, 12, 13, 14, 34 + 52, 0",
+
+			"0, 0, 12, 13, 14, 15,0",
+			"0,0,12,13,14,23+15,0",
+			"0,0,0,12,14,24,0",
+			"0,0,0,12,13+42,14+23,0",
+			"0,0,0,12,14,13+42,0",
+			"0,0,0,12,13+14,24,0",
+			"0,0,0,12,13,14,0",
+			"0,0,0,0,12,15,0",
+
+			//irreducible, step 2
+			"0,0,0,0,12,23,24",
+			"0,0,0,0,12,23,34",
+			"0,0,0,0,12+34,23,24",
+			"0,0,0,0,12+34,13,24",
+			"0,0,0,0,0,12,14+35",
+			"0,0,0,0,0,12+34,15+23",
+			"0,0,0,0,0,0,12+34+56",
+			"0,0,0,0,12-34,13+24,14",
+			"0,0,0,0,12-34,13+24,14-23",
+
+			//irreducible, step 3
+			"0,0,12,0,13,24,14",
+			"0,0,12,0,13,23,14",
+			"0,0,12,0,13+24,23,14",
+			"0,0,12,0,0,13+24,15",
+			"0,0,12,0,0,13,14+25",
+			"0,0,12,0,0,13+24,25",
+			"0,0,12,0,0,13+24,14+25",
+			"0,0,12,0,0,13+45,24",
+			"0,0,12,0,0,13+45,15+24",
+			"0,0,12,0,0,13+24,45",
+			"0,0,12,0,0,13+14,15+23",
+			"0,0,12,0,0,13+24,15+23",
+			"0,0,12,0,0,13,23+45",
+			"0,0,12,0,0,13+24,23+45",
+			"0,0,0,12,13,14,15",
+			"0,0,0,12,13,14,35",
+			"0,0,0,12,13,14+35,15",
+			"0,0,0,12,13,14,25+34",
+			"0,0,0,12,13,14+15,25+34",
+			"0,0,0,12,13,24+35,25+34",
+			"0,0,0,12,13,14+15+24+35,25+34",
+			"0,0,0,12,13,14+24+35,25+34",
+			"0,0,0,12,13,25+34,35",
+			"0,0,0,12,13,15+35,25+34",
+			"0,0,0,12,13,14+35,25+34",
+			"0,0,0,12,13,14+23,15",
+			"0,0,0,12,13,14+23,35",
+			"0,0,0,12,13,15+24,23",
+			"0,0,0,12,13,14+35,15+23",
+			"0,0,0,12,13,23,25+34",
+			"0,0,0,12,13,14+23,25+34",
+			"0,0,0,12,13,14+15+23,25+34",
+			"0,0,12,0,0,0,13+24+56",
 	
-		add("0,0,0,12,13,0,16+25+34");
-		add("0,0,0,12,13,0,14+26+35");
-		add("0,0,0,12,23,-13,15+26+16-2*34");
-		add("0,0,0,0,12,34,15+36");
-		add("0,0,0,0,12,34,15+24+36");
-		add("0,0,0,0,12,14+23,16-35");
-		add("0,0,0,0,12,14+23,16+24-35");	
-		add("0,0,12,0,0,13+14+25,15+23");
-		add("0,0,0,12,13,14,24+35");
-		add("0,0,0,12,13,24-35,25+34");
-		add("0,0,0,12,13,14+24-35,25+34");
-		add("0,0,0,12,13,23,24+35");
-		add("0,0,0,12,13,14+23,24+35");
-		add("0,0,0,12,13,0,16+24+35");	//new???
-		add("0,0,0,0,13+24,14-23,15+26");	//137A1
-		add("0,0,0,0,13+24,14-23,15+26+24");	//137B1	
-
-		//step 4
-		add("0,0,12,13,0,14,15");
-		add("0,0,12,13,0,25,14");
-		add("0,0,12,13,0,14+25,15");
-		add("0,0,12,13,0,14+23+25,15");
-		add("0,0,12,13,0,23+25,14");
-		add("0,0,12,13,0,14+23,15");
-		add("0,0,12,13,0,15+23,14");
-		add("0,0,12,13,0,23,14+25");
-		add("0,0,12,13,0,14+23,25");
-		add("0,0,12,13,0,14+23,23+25");
-
-		add("0,0,12,13,0,15+23,14+25");
-		add("0,0,12,13,23,14+25,15+24");
-		add("0,0,12,13,23,24+15,14");
-		add("0,0,0,12,14+23,13,15-34");
-		add("0,0,0,12,14+23,24,15-34");
-		add("0,0,0,12,14+23,13+24,15-34");
-		add("0,0,12,13,0,0,14+56");
-		add("0,0,12,13,0,0,23+14+56");
-		add("0,0,0,12,14+23,0,15+26-34");
-		add("0,0,0,12,14+23,0,15+36-34");
-		add("0,0,0,12,14+23,0,15+24+36-34");
-		add("0,0,12,0,23,24,16+25+34");
-		add("0,0,12,0,23,24,25+46");
-		add("0,0,12,0,23,24,13+25-46");
-		add("0,0,12,0,23,14,16+25");
-		add("0,0,12,0,23,14,16+25+26-34");
-		add("0,0,12,0,23,14,25+46");
-		add("0,0,12,0,23,14,13+25+46");
-		add("0,0,12,0,13+24,14,15+23+1/2*(26+34)");
-		add("0,0,12,0,13+24,23,16+25");
+			"0,0,0,12,13,0,16+25+34",
+			"0,0,0,12,13,0,14+26+35",
+			"0,0,0,12,23,-13,15+26+16-2*34",
+			"0,0,0,0,12,34,15+36",
+			"0,0,0,0,12,34,15+24+36",
+			"0,0,0,0,12,14+23,16-35",
+			"0,0,0,0,12,14+23,16+24-35",
+			"0,0,12,0,0,13+14+25,15+23",
+			"0,0,0,12,13,14,24+35",
+			"0,0,0,12,13,24-35,25+34",
+			"0,0,0,12,13,14+24-35,25+34",
+			"0,0,0,12,13,23,24+35",
+			"0,0,0,12,13,14+23,24+35",
+			"0,0,0,12,13,0,16+24+35",	//new???
+			"0,0,0,0,13+24,14-23,15+26",	//137A1
+			"0,0,0,0,13+24,14-23,15+26+24",	//137B1	
+
+			//step 4
+			"0,0,12,13,0,14,15",
+			"0,0,12,13,0,25,14",
+			"0,0,12,13,0,14+25,15",
+			"0,0,12,13,0,14+23+25,15",
+			"0,0,12,13,0,23+25,14",
+			"0,0,12,13,0,14+23,15",
+			"0,0,12,13,0,15+23,14",
+			"0,0,12,13,0,23,14+25",
+			"0,0,12,13,0,14+23,25",
+			"0,0,12,13,0,14+23,23+25",
+
+			"0,0,12,13,0,15+23,14+25",
+			"0,0,12,13,23,14+25,15+24",
+			"0,0,12,13,23,24+15,14",
+			"0,0,0,12,14+23,13,15-34",
+			"0,0,0,12,14+23,24,15-34",
+			"0,0,0,12,14+23,13+24,15-34",
+			"0,0,12,13,0,0,14+56",
+			"0,0,12,13,0,0,23+14+56",
+			"0,0,0,12,14+23,0,15+26-34",
+			"0,0,0,12,14+23,0,15+36-34",
+			"0,0,0,12,14+23,0,15+24+36-34",
+			"0,0,12,0,23,24,16+25+34",
+			"0,0,12,0,23,24,25+46",
+			"0,0,12,0,23,24,13+25-46",
+			"0,0,12,0,23,14,16+25",
+			"0,0,12,0,23,14,16+25+26-34",
+			"0,0,12,0,23,14,25+46",
+			"0,0,12,0,23,14,13+25+46",
+			"0,0,12,0,13+24,14,15+23+1/2*(26+34)",
+			"0,0,12,0,13+24,23,16+25",
 	
-		//p.504 
-		add("0,0,12,0,13+24,23,15+26+34");
-		add("0,0,12,0,13,23+24,15+26");
-		add("0,0,12,0,13,23+24,16+25+34");
-		add("0,0,12,13,23,14-25,15+24");
-		add("0,0,0,12,14+23,13-24,15-34");
-		add("0,0,12,0,23,24,13+25+46");	//137F1	
-		add("0,0,12,0,13+24,23,15+34-26");	//137P1	
-		add("0,0,12,0,13,23+24,15-26");	//1357Q1
-
-		//step 5
-		add("0,0,12,13,14,15,23");
-		add("0,0,12,13,14,25-34,23");
-		add("0,0,12,13,14,15,25-34");
-		add("0,0,12,13,14,15+23,25-34");
-		add("0,0,12,13,14+23,15+24,23");
-		add("0,0,12,13,14+23,25-34,23");
-		add("0,0,12,13,14+23,15+24,25-34");
-		add("0,0,12,13,14,0,15+26");
-		add("0,0,12,13,14,0,15+23+26");
-		add("0,0,12,13,14,0,16+25-34");
-		add("0,0,12,13,14+23,0,15+24+26");
-		add("0,0,12,13,14+23,0,16+25-34");
-		add("0,0,12,13,14,23,15+26");
-		add("0,0,12,13,14,23,16+24+25-34");
-		add("0,0,12,13,14,23,15+25+26-34");
-		add("0,0,12,13,0,14+25,16+35");
-
-		add("0,0,12,13,0,14+25,16+25+35"); 
-		add("0,0,12,13,0,14+25,26-34");
-		add("0,0,12,13,0,14+25,15+26-34");
-		add("0,0,12,13,0,14+23+25,16+24+35");
-		add("0,0,12,13,0,14+23+25,26-34");
-		add("0,0,12,13,0,14+23+25,15+26-34");
-		add("0,0,12,13,23,15+24,16+34");
-		add("0,0,12,13,23,15+24,16+25+34");
-		add("0,0,12,13,23,15+24,16+14+25+34");
-		add("0,0,12,13,23,15+24,16+14+34");
-		add("0,0,12,13,23,15+24,16+26+34-35");
-		add("0,0,0,12,14+23,15-34,16-35");
-		add("0,0,0,12,14+23,15-34,16+23-35");
-		add("0,0,0,12,14+23,15-34,16+24-35");
-		add("0,0,12,13,23,24+15,16+14-25+34");	//12457J1
-		add("0,0,12,13,23,-14-25,16-35");		//12457L1
-		add("0,0,12,13,23,-14-25,16-35+25");		//12457N1
-		add("0,0,0,12,14+23,15-34,16-23-35");	//12357B1
-
-		add("0,0,12,0,0,23+45,24");
-
-		//p.61
-		add("0,0,12,13,14,15,16");
-		add("0,0,12,13,14,15,16+23");
-		add("0,0,12,13,14,15,16+25-34");
-		add("0,0,12,13,14,15+23,16+24");
-		add("0,0,12,13,14,15+23,16+23+24");
-		add("0,0,12,13,14,15+23,16+24+25-34");
-		add("0,0,12,13,14+23,15+24,16+23+25");	
-
-		//p. 62
-		add("0,0,12,13,14+23,15+24,-16+23-25");	//123457H1
-
-	//one-parameter families		
-		add("0,0,0,12,23,-13,[lambda]*26-15-[lambda-1]*34 ",N.lambda);
-		add("0,0,12,0,24+13,14,[1-lambda]*34 +15+[lambda]*26",N.lambda);
-		add("0,0,12,0,13+24,14,46+34+15+[lambda]*23",N.lambda);
-		add("0,0,12,0,13,24+23,25+34+16+15+[lambda]*26",N.lambda);
-		add("0,0,12,13,23,24+15,[lambda]*25+26+34-35+16+14",N.lambda);
-		add("0,0,12,13,14+23,24+15,[lambda]*25-[lambda-1]*34+16",N.lambda);
-		add("0,0,0,12,23,-13,2*26-2*34-[lambda]*16+[lambda]*25",N.lambda);
-		add("0,0,12,0,13+24,14-23,[lambda]*26+15-[lambda-1]*34",N.lambda);
-		add("0,0,12,13,23,-14-25,15-35+16+24+[lambda]*25",N.lambda);
+			//p.504 
+			"0,0,12,0,13+24,23,15+26+34",
+			"0,0,12,0,13,23+24,15+26",
+			"0,0,12,0,13,23+24,16+25+34",
+			"0,0,12,13,23,14-25,15+24",
+			"0,0,0,12,14+23,13-24,15-34",
+			"0,0,12,0,23,24,13+25+46",	//137F1	
+			"0,0,12,0,13+24,23,15+34-26",	//137P1	
+			"0,0,12,0,13,23+24,15-26",	//1357Q1
+
+			//step 5
+			"0,0,12,13,14,15,23",
+			"0,0,12,13,14,25-34,23",
+			"0,0,12,13,14,15,25-34",
+			"0,0,12,13,14,15+23,25-34",
+			"0,0,12,13,14+23,15+24,23",
+			"0,0,12,13,14+23,25-34,23",
+			"0,0,12,13,14+23,15+24,25-34",
+			"0,0,12,13,14,0,15+26",
+			"0,0,12,13,14,0,15+23+26",
+			"0,0,12,13,14,0,16+25-34",
+			"0,0,12,13,14+23,0,15+24+26",
+			"0,0,12,13,14+23,0,16+25-34",
+			"0,0,12,13,14,23,15+26",
+			"0,0,12,13,14,23,16+24+25-34",
+			"0,0,12,13,14,23,15+25+26-34",
+			"0,0,12,13,0,14+25,16+35",
+
+			"0,0,12,13,0,14+25,16+25+35",
+			"0,0,12,13,0,14+25,26-34",
+			"0,0,12,13,0,14+25,15+26-34",
+			"0,0,12,13,0,14+23+25,16+24+35",
+			"0,0,12,13,0,14+23+25,26-34",
+			"0,0,12,13,0,14+23+25,15+26-34",
+			"0,0,12,13,23,15+24,16+34",
+			"0,0,12,13,23,15+24,16+25+34",
+			"0,0,12,13,23,15+24,16+14+25+34",
+			"0,0,12,13,23,15+24,16+14+34",
+			"0,0,12,13,23,15+24,16+26+34-35",
+			"0,0,0,12,14+23,15-34,16-35",
+			"0,0,0,12,14+23,15-34,16+23-35",
+			"0,0,0,12,14+23,15-34,16+24-35",
+			"0,0,12,13,23,24+15,16+14-25+34",	//12457J1
+			"0,0,12,13,23,-14-25,16-35",		//12457L1
+			"0,0,12,13,23,-14-25,16-35+25",		//12457N1
+			"0,0,0,12,14+23,15-34,16-23-35",	//12357B1
+
+			"0,0,12,0,0,23+45,24",
+
+			//p.61
+			"0,0,12,13,14,15,16",
+			"0,0,12,13,14,15,16+23",
+			"0,0,12,13,14,15,16+25-34",
+			"0,0,12,13,14,15+23,16+24",
+			"0,0,12,13,14,15+23,16+23+24",
+			"0,0,12,13,14,15+23,16+24+25-34",
+			"0,0,12,13,14+23,15+24,16+23+25",
+
+			//p. 62
+			"0,0,12,13,14+23,15+24,-16+23-25",	//123457H1
+
+			//one-parameter families
+			"0,0,0,12,23,-13,[lambda]*26-15-[lambda-1]*34 ; lambda",
+			"0,0,12,0,24+13,14,[1-lambda]*34 +15+[lambda]*26; lambda",
+			"0,0,12,0,13+24,14,46+34+15+[lambda]*23; lambda",
+			"0,0,12,0,13,24+23,25+34+16+15+[lambda]*26; lambda",
+			"0,0,12,13,23,24+15,[lambda]*25+26+34-35+16+14; lambda",
+			"0,0,12,13,14+23,24+15,[lambda]*25-[lambda-1]*34+16; lambda",
+			"0,0,0,12,23,-13,2*26-2*34-[lambda]*16+[lambda]*25; lambda",
+			"0,0,12,0,13+24,14-23,[lambda]*26+15-[lambda-1]*34; lambda",
+			"0,0,12,13,23,-14-25,15-35+16+24+[lambda]*25; lambda",
+		};
+		for (auto entry: entries) add(entry);
 	}
 };
 
@@ -282,61 +464,56 @@ public:
 /* Nonnice nilpotent Lie groups of dimension 7, as per
  	Diego Conti, Federico Rossi. Construction of nice nilpotent Lie groups. Journal of Algebra, (2019) 525:311-340. doi:10.1016/j.jalgebra.2019.01.020 [Table 2]
  */
-class NonniceNilpotentLieGroups7 : public Classification<LieGroup> {
-	void add(const char* structure_constants) {
-		Classification<LieGroup>::add(make_unique<AbstractLieGroup<false>>	(structure_constants));
-	}
-	template <typename... T>
-	void add(const char* structure_constants, const T&... names) {
-		Classification<LieGroup>::add(make_unique<AbstractLieGroup<true>>	(structure_constants, names...));
-	}
-
+class NonniceNilpotentLieGroups7 : public LieGroupClassification {
 public:
 	NonniceNilpotentLieGroups7() {
-		//reducible
-		add("0,0,12,13,0,14+23+25,0");
-
-
-		add("0,0,12,13,14,15+23,16+23+24");
-		add("0,0,12,13,14,15+23,16+24+25-34");		
-		add("0,0,12,13,14+23,15+24,16+23+25");	
-		add("0,0,12,13,14+23,15+24,-16+23-25");	//123457H1
-
-		add("0,0,12,13,14+23,15+24,23");
-		add("0,0,12,13,14+23,25-34,23");
-		add("0,0,12,13,14,23,16+25+24-34");
-		add("0,0,12,13,14,23,15+25+26-34");
-		add("0,0,12,13,23,15+24,14+16+25+34");
-		add("0,0,12,13,23,15+24,14+16-25+34");
-		add("0,0,12,13,23,15+24,14+16+34");
-		add("0,0,12,13,23,15+24,14+16+[lambda]*25+26+34-35",N.lambda);
-
-		add("0,0,12,13,23,-14-25,16+25-35");
-		add("0,0,12,13,23,-14-25,15+16+24+[lambda]*25-35",N.lambda);
-		add("0,0,12,13,14,0,15+23+26");
-		add("0,0,12,13,14+23,0,15+24+26");
-		add("0,0,12,13,0,14+25,25+35+16");  	//scritta male in construction
-		add("0,0,12,13,0,14+23+25,16+24+35");
-		add("0,0,12,13,0,14+23+25,26-34"); 
-		add("0,0,12,13,0,14+23+25,15+26-34");
-		add("0,0,0,12,14+23,15-34,16+23-35");
-		add("0,0,12,13,0,25+23,14");
-		add("0,0,12,13,0,14+23,23+25");
-		add("0,0,12,0,13,23+24,15+16+25+[lambda]*26+34",N.lambda);
-		add("0,0,12,13,0,14+23+25,0");
-		add("0,0,12,13,0,14+25+23,15");
-		add("0,0,0,12,14+23,23,15-34");
-		add("0,0,12,0,23,14,16+26+25-34");
-		add("0,0,12,0,24+13,14,15+23+1/2*26+1/2*34");
-		add("0,0,12,0,24+13,14,15+[lambda]*23+34+46",N.lambda);
-		add("0,0,0,12,13,14+24-35,25+34");
-		add("0,0,0,12,13,15+35,25+34");
-		add("0,0,0,12,23,-13,15+16+26-2*34");
-		add("0,0,0,12,23,-13,[-lambda]*16+[lambda]*25+2*26-2*34",N.lambda);
-		add("0,0,0,12,14+23,0,15-34+36");
-		add("0,0,0,12,14+23,0,15-34+24+36");
-		add("0,0,12,0,0,13+14,15+23");
-		add("0,0,12,0,0,13+14+25,15+23");
+		static const char* entries[]={
+			//reducible
+			"0,0,12,13,0,14+23+25,0",
+
+
+			"0,0,12,13,14,15+23,16+23+24",
+			"0,0,12,13,14,15+23,16+24+25-34",
+			"0,0,12,13,14+23,15+24,16+23+25",
+			"0,0,12,13,14+23,15+24,-16+23-25",	//123457H1
+
+			"0,0,12,13,14+23,15+24,23",
+			"0,0,12,13,14+23,25-34,23",
+			"0,0,12,13,14,23,16+25+24-34",
+			"0,0,12,13,14,23,15+25+26-34",
+			"0,0,12,13,23,15+24,14+16+25+34",
+			"0,0,12,13,23,15+24,14+16-25+34",
+			"0,0,12,13,23,15+24,14+16+34",
+			"0,0,12,13,23,15+24,14+16+[lambda]*25+26+34-35; lambda",
+
+			"0,0,12,13,23,-14-25,16+25-35",
+			"0,0,12,13,23,-14-25,15+16+24+[lambda]*25-35; lambda",
+			"0,0,12,13,14,0,15+23+26",
+			"0,0,12,13,14+23,0,15+24+26",
+			"0,0,12,13,0,14+25,25+35+16",  	//scritta male in construction
+			"0,0,12,13,0,14+23+25,16+24+35",
+			"0,0,12,13,0,14+23+25,26-34",
+			"0,0,12,13,0,14+23+25,15+26-34",
+			"0,0,0,12,14+23,15-34,16+23-35",
+			"0,0,12,13,0,25+23,14",
+			"0,0,12,13,0,14+23,23+25",
+			"0,0,12,0,13,23+24,15+16+25+[lambda]*26+34; lambda",
+			"0,0,12,13,0,14+23+25,0",
+			"0,0,12,13,0,14+25+23,15",
+			"0,0,0,12,14+23,23,15-34",
+			"0,0,12,0,23,14,16+26+25-34",
+			"0,0,12,0,24+13,14,15+23+1/2*26+1/2*34",
+			"0,0,12,0,24+13,14,15+[lambda]*23+34+46; lambda",
+			"0,0,0,12,13,14+24-35,25+34",
+			"0,0,0,12,13,15+35,25+34",
+			"0,0,0,12,23,-13,15+16+26-2*34",
+			"0,0,0,12,23,-13,[-lambda]*16+[lambda]*25+2*26-2*34; lambda",
+			"0,0,0,12,14+23,0,15-34+36",
+			"0,0,0,12,14+23,0,15-34+24+36",
+			"0,0,12,0,0,13+14,15+23",
+			"0,0,12,0,0,13+14+25,15+23",
+		};
+		for (auto entry: entries) add(entry);
 	}
 };
 
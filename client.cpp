@@ -0,0 +1,70 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+/** Send the lines read from standard input to a server started with gleipnir --serve, as a single batch, and print the answers on standard output
+
+	The whole input is sent before reading the answers; the server buffers the answers, so that this does not deadlock.
+*/
+int main(int argc, char** argv) {
+	if (argc!=2) {
+		cerr<<"usage: gleipnir_client SOCKET < REQUESTS"<<endl;
+		return 1;
+	}
+	string path=argv[1];
+	sockaddr_un address{};
+	address.sun_family=AF_UNIX;
+	if (path.size()>=sizeof(address.sun_path)) {
+		cerr<<"socket path too long: "<<path<<endl;
+		return 1;
+	}
+	path.copy(address.sun_path,path.size());
+	int fd=socket(AF_UNIX,SOCK_STREAM,0);
+	if (fd<0 || connect(fd,reinterpret_cast<sockaddr*>(&address),sizeof(address))) {
+		cerr<<"cannot connect to "<<path<<endl;
+		return 1;
+	}
+	stringstream requests;
+	requests<<cin.rdbuf();
+	auto data=requests.str();
+	for (size_t sent=0;sent<data.size();) {
+		auto bytes=write(fd,data.data()+sent,data.size()-sent);
+		if (bytes<0 && errno==EINTR) continue;
+		if (bytes<0) {
+			cerr<<"connection lost"<<endl;
+			return 1;
+		}
+		sent+=bytes;
+	}
+	shutdown(fd,SHUT_WR);
+	char buffer[65536];
+	for (ssize_t bytes;(bytes=read(fd,buffer,sizeof(buffer)))!=0;)
+		if (bytes>0) cout.write(buffer,bytes);
+		else if (errno!=EINTR) break;
+	cout<<flush;
+	close(fd);
+}
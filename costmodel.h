@@ -0,0 +1,82 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <fstream>
+#include <stdexcept>
+#include "shard.h"
+
+/** An estimate of the time needed to study each Lie algebra, combining the times recorded by previous runs with estimated_cost
+
+	Times are recorded in a file, one per line, as the number of seconds followed by a tab and the description of the Lie algebra; the last line wins if a Lie algebra appears more than once. Lie algebras without a recorded time are assigned their estimated_cost, converted to seconds by the ratio between the recorded times and the estimated costs of the Lie algebras that have one, so that both kinds of costs can be compared.
+*/
+class CostModel {
+	std::map<std::string,double,std::less<>> recorded;
+	double seconds_per_unit=1;
+	std::ofstream file;
+	void load(const std::string& path) {
+		std::ifstream timings{path};
+		std::string line;
+		while (getline(timings,line)) {
+			auto tab=line.find('\t');
+			if (tab==std::string::npos) continue;
+			size_t end=0;
+			double seconds=0;
+			try {seconds=std::stod(line.substr(0,tab),&end);}
+			catch (const std::exception&) {continue;}
+			if (end==tab && seconds>=0) recorded[line.substr(tab+1)]=seconds;
+		}
+		double total_seconds=0, total_units=0;
+		for (auto& timing: recorded) {
+			total_seconds+=timing.second;
+			total_units+=estimated_cost(timing.first);
+		}
+		if (total_seconds>0 && total_units>0) seconds_per_unit=total_seconds/total_units;
+	}
+public:
+/** Create a cost model that only uses estimated_cost */
+	CostModel()=default;
+/** Create a cost model using the times recorded in a file, to which further times are appended
+	@param path The name of the file; it is created if it does not exist
+	@exception std::runtime_error if the file cannot be opened
+*/
+	explicit CostModel(const std::string& path) {
+		load(path);
+		file.open(path,std::ios::app);
+		if (!file) throw std::runtime_error("cannot open timings file "+path);
+	}
+/** Return the estimated cost of studying a Lie algebra, in seconds if any time was recorded
+	@param description A Lie algebra in the format accepted by lie_group_from_string
+*/
+	double cost(std::string_view description) const {
+		auto i=recorded.find(description);
+		return i!=recorded.end()? i->second : seconds_per_unit*estimated_cost(description);
+	}
+/** Record the time taken to study a Lie algebra, appending it to the file if there is one; later calls to cost are not affected by the calibration */
+	void record(std::string_view description, double seconds) {
+		recorded[std::string{description}]=seconds;
+		if (file.is_open()) file<<seconds<<'\t'<<description<<'\n'<<std::flush;
+	}
+};
+
+#endif
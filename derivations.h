@@ -20,42 +20,254 @@
 #define DERIVATIONS_H
 
 #include <wedge/wedge.h>
+#include <optional>
+#include <tuple>
 #include "linearsolve.h"
+#include "sparselinear.h"
+#include "modular.h"
+#include "structureconstants.h"
+#include "grading.h"
 
 using namespace GiNaC;
 using namespace std;
 using namespace Wedge;
 
-ex Xbracket(const LieGroup& G, const GLRepresentation<VectorField>& V, ex A, ex X, ex Y) {
-	ex Ax=V.Action<VectorField>(A,X);
-	ex Ay=V.Action<VectorField>(A,Y);
-	ex Axy=V.Action<VectorField>(A,G.LieBracket(X,Y));
-	return G.LieBracket(Ax,Y)+G.LieBracket(X,Ay)-Axy;
+/** Return the matrix of an element of gl acting on the Lie algebra of G
+	@param G a Lie group of dimension n
+	@param V the representation of gl on the Lie algebra of G
+	@param A an element of gl
+	@return a vector of size n^2 whose entry l*n+i is the coefficient of e_l in Ae_i (zero-based indices)
+*/
+exvector action_matrix(const LieGroup& G, const GLRepresentation<VectorField>& V, ex A) {
+	int n=G.Dimension();
+	exvector a(n*n);
+	for (int i=0;i<n;++i) {
+		ex Ae=V.Action<VectorField>(A,G.e(i+1)).expand();
+		for (int l=0;l<n;++l) a[l*n+i]=Ae.coeff(G.e(l+1));
+	}
+	return a;
 }
 
-exvector Xbrackets(const LieGroup& G, const GLRepresentation<VectorField>& V, ex A) {
+/** Return the components of [Ae_i,e_j]+[e_i,Ae_j]-A[e_i,e_j], which vanish for all i,j if and only if A is a derivation
+	@param c The structure constants of the Lie algebra
+	@param a The matrix of A, as returned by action_matrix
+	@param i,j Zero-based indices
+	@return The vector of components relative to the basis e_1,...,e_n
+	
+	Only the nonzero structure constants are visited.
+*/
+exvector Xbracket(const StructureConstants& c, const exvector& a, int i, int j) {
+	int n=c.dimension();
+	exvector result(n);
+	for (int l=0;l<n;++l) {
+		if (!a[l*n+i].is_zero()) 
+			for (auto& x: c.bracket(l,j)) result[x.k]+=a[l*n+i]*x.c;
+		if (!a[l*n+j].is_zero()) 
+			for (auto& x: c.bracket(i,l)) result[x.k]+=a[l*n+j]*x.c;
+	}
+	for (auto& x: c.bracket(i,j))
+		for (int k=0;k<n;++k) 
+			if (!a[k*n+x.k].is_zero()) result[k]-=x.c*a[k*n+x.k];
+	return result;
+}
+
+exvector Xbrackets(const LieGroup& G, const StructureConstants& c, const GLRepresentation<VectorField>& V, ex A) {
+		auto a=action_matrix(G,V,A);
 		exvector Xbrackets;
-		for (int i=1;i<=G.Dimension();++i)
-		for (int j=i+1;j<=G.Dimension();++j) 
-			Xbrackets.push_back(Xbracket(G,V,A,G.e(i),G.e(j)).expand());				
+		for (int i=0;i<G.Dimension();++i)
+		for (int j=i+1;j<G.Dimension();++j) {
+			auto components=Xbracket(c,a,i,j);
+			ex X;
+			for (int k=0;k<G.Dimension();++k) X+=components[k].expand()*G.e(k+1);
+			Xbrackets.push_back(X);
+		}
 		return Xbrackets;
 }
 
+exvector Xbrackets(const LieGroup& G, const GLRepresentation<VectorField>& V, ex A) {
+		return Xbrackets(G,StructureConstants{G},V,A);
+}
+
+/** Convert a rational number from its GiNaC to its GMP representation */
+inline mpq_class to_mpq(const numeric& x) {
+	stringstream numerator, denominator;
+	numerator<<x.numer();
+	denominator<<x.denom();
+	mpq_class result{mpz_class{numerator.str()},mpz_class{denominator.str()}};
+	result.canonicalize();
+	return result;
+}
+
+/** Convert a rational number from its GMP to its GiNaC representation */
+inline numeric to_numeric(const mpq_class& x) {
+	return numeric(x.get_num().get_str().c_str())/numeric(x.get_den().get_str().c_str());
+}
+
+/** Return the condition for a linear map to be a derivation, as a sparse linear system with integer coefficients
+	@param c The structure constants of a Lie algebra, assumed to be rational
+	@param action A vector of size n^2, whose entry l*n+i is the coefficient of e_l in Ae_i, as a linear function of the unknowns
+	@param columns The number of unknowns
+	@return The equations, as primitive integer rows
+	
+	The equations are assembled directly from the nonzero structure constants c_ij^k, where [e_i,e_j]=c_ij^k e_k. The equation corresponding to i<j and k is the e_k-component of [Ae_i,e_j]+[e_i,Ae_j]-A[e_i,e_j].
+*/
+IntegerEquations derivation_equations(const StructureConstants& c, const vector<RationalRow>& action, int columns) {
+	int n=c.dimension();
+	map<tuple<int,int,int>,RationalRow> rows;
+	auto add=[&rows] (int i, int j, int k, const RationalRow& linear_form, const mpq_class& factor) {
+		if (linear_form.empty()) return;
+		auto& row=rows[{i,j,k}];
+		for (auto& entry: linear_form) row[entry.first]+=factor*entry.second;
+	};
+	for (int i=0;i<n;++i)
+	for (int j=0;j<n;++j) 
+		for (auto& x: c.bracket(i,j)) {
+			auto c_ij=to_mpq(ex_to<numeric>(x.c));
+			for (int h=0;h<j;++h) add(h,j,x.k,action[i*n+h],c_ij);		//[Ae_h,e_j] contains a_ih c_ij^k e_k
+			for (int h=i+1;h<n;++h) add(i,h,x.k,action[j*n+h],c_ij);	//[e_i,Ae_h] contains a_jh c_ij^k e_k
+		}
+	for (auto ij: c.nonzero_brackets())
+		for (auto& x: c.bracket(ij.first,ij.second)) {
+			auto c_ij=to_mpq(ex_to<numeric>(x.c));
+			for (int k=0;k<n;++k) add(ij.first,ij.second,k,action[k*n+x.k],-c_ij);	//A[e_i,e_j] contains c_ij^m a_km e_k
+		}
+	IntegerEquations equations{columns,{}};
+	for (auto& row: rows) {
+		auto integer_row=to_integer_row(row.second);
+		if (!integer_row.empty()) equations.rows.push_back(move(integer_row));
+	}
+	return equations;
+}
+
+/** Return the condition for an n by n matrix to be a derivation, as a sparse linear system with integer coefficients
+	@param c The structure constants of a Lie algebra of dimension n
+	@return The equations in the n^2 unknowns a_li, indexed by l*n+i, where a_li is the coefficient of e_l in Ae_i, or nothing if the structure constants are not all rational
+	
+	No symbolic computation is involved, so this is suitable for screening Lie algebras by the dimension of their derivation algebra, @sa modular_kernel_dimension.
+*/
+optional<IntegerEquations> derivation_equations(const StructureConstants& c) {
+	if (!c.is_rational()) return nullopt;
+	int n=c.dimension();
+	vector<RationalRow> action(n*n);
+	for (int li=0;li<n*n;++li) action[li][li]=1;
+	return derivation_equations(c,action,n*n);
+}
+
+/** Return the matrix of the generic element of gl as linear functions of the coordinates of gl
+	@param gl The space of 1-forms on GL(n,R)
+	@param a The matrix of the generic element of gl, as returned by action_matrix
+	@return A vector of size n^2, whose entry l*n+i is the coefficient of e_l in Ae_i, as a linear function of the coordinates, or nothing if the coefficients are not rational
+*/
+optional<vector<RationalRow>> rational_action(const VectorSpace<DifferentialForm>& gl, const exvector& a) {
+	exvector coordinates{gl.coordinate_begin(),gl.coordinate_end()};
+	vector<RationalRow> action(a.size());
+	for (int li=0;li<a.size();++li) 
+		for (int x=0;x<coordinates.size();++x) {
+			ex coeff=a[li].coeff(coordinates[x]);
+			if (coeff.is_zero()) continue;
+			if (!is_a<numeric>(coeff)) return nullopt;
+			action[li][x]=to_mpq(ex_to<numeric>(coeff));
+		}
+	return action;
+}
+
+/** Return the condition for an element of gl to be a derivation as a sparse linear system with integer coefficients, given the action of the generic element of gl
+	@param c The structure constants of a Lie algebra
+	@param gl The space of 1-forms on GL(n,R), whose coordinates index the columns of the system
+	@param a The matrix of the generic element of gl, as returned by action_matrix
+	@return The equations, as primitive integer rows, or nothing if the structure constants are not all rational
+*/
+optional<IntegerEquations> rational_derivation_equations(const StructureConstants& c, const VectorSpace<DifferentialForm>& gl, const exvector& a) {
+	if (!c.is_rational()) return nullopt;
+	auto action=rational_action(gl,a);
+	if (!action) return nullopt;
+	return derivation_equations(c,*action,distance(gl.coordinate_begin(),gl.coordinate_end()));
+}
+
+/** Return the condition for an element of gl to be a derivation as a sparse linear system with integer coefficients
+	@param G a Lie group of dimension n
+	@param c The structure constants of G
+	@param Gl The Lie algebra of GL(n,R)
+	@param gl The space of 1-forms on GL(n,R), whose coordinates index the columns of the system
+	@return The equations, as primitive integer rows, or nothing if the structure constants of G are not all rational
+	
+	The only symbolic computation is the action of the generic element A of gl on e_1,...,e_n.
+*/
+optional<IntegerEquations> rational_derivation_equations(const LieGroup& G, const StructureConstants& c, const GL& Gl, const VectorSpace<DifferentialForm>& gl) {
+	if (!c.is_rational()) return nullopt;
+	return rational_derivation_equations(c,gl,action_matrix(G,GLRepresentation<VectorField>(&Gl,G.e()),gl.GenericElement()));
+}
+
+optional<IntegerEquations> rational_derivation_equations(const LieGroup& G, const GL& Gl, const VectorSpace<DifferentialForm>& gl) {
+	return rational_derivation_equations(G,StructureConstants{G},Gl,gl);
+}
+
+/** Return a basis of the space of solutions of a linear system in the coordinates of gl, as elements of gl
+	@param equations A linear system whose columns correspond to the coordinates of gl
+	@param gl The space of 1-forms on GL(n,R)
+	@param kernel A basis of the space of solutions, as computed by rational_kernel or block_kernel
+	@return A basis of the subspace of gl defined by the system
+*/
+exvector solutions_in_gl(const VectorSpace<DifferentialForm>& gl, const vector<RationalRow>& kernel) {
+	exvector coordinates{gl.coordinate_begin(),gl.coordinate_end()};
+	auto generic_matrix=gl.GenericElement().expand();
+	exvector basis;
+	for (auto x: coordinates) basis.push_back(generic_matrix.coeff(x));
+	exvector result;
+	for (auto& solution: kernel) {
+		ex X;
+		for (auto& entry: solution) X+=to_numeric(entry.second)*basis[entry.first];
+		result.push_back(X);
+	}
+	return result;
+}
+
+/** Return a basis of the space of solutions of a linear system in the coordinates of gl, as elements of gl, @sa rational_kernel */
+exvector solutions_in_gl(const IntegerEquations& equations, const VectorSpace<DifferentialForm>& gl) {
+	return solutions_in_gl(gl,rational_kernel(equations));
+}
+
+/** Return a basis of the space of derivations of a Lie algebra with rational structure constants, solving the equations separately on each weight space of the torus of diagonal derivations
+	@param c The structure constants of a Lie algebra
+	@param gl The space of 1-forms on GL(n,R)
+	@param a The matrix of the generic element of gl, as returned by action_matrix
+	@param threads The number of threads used to solve the blocks, @sa block_kernel
+	@return A basis of the space of derivations, as elements of gl, or nothing if the structure constants are not all rational
+*/
+optional<exvector> rational_derivations(const StructureConstants& c, const VectorSpace<DifferentialForm>& gl, const exvector& a, int threads) {
+	if (!c.is_rational()) return nullopt;
+	auto action=rational_action(gl,a);
+	if (!action) return nullopt;
+	int columns=distance(gl.coordinate_begin(),gl.coordinate_end());
+	auto equations=derivation_equations(c,*action,columns);
+	return solutions_in_gl(gl,block_kernel(equations,weight_blocks(c,*action,columns),threads));
+}
+
 /** Return the space of derivations, as a subspace of gl, 
 	@param G a Lie group without parameters of dimension n
 	@param Gl The Lie algebra of GL(n,R), acting on the Lie algebra of g through the identification g=R^n given by the standard coframe of g
 	@result A subspace of Gl corresponding to the space of derivations
+	
+	If the structure constants are rational, the space is computed exactly from the sparse equations, one weight space at a time (@sa rational_derivations); otherwise, the equations are solved symbolically.
 */	
-VectorSpace<DifferentialForm> derivations(const LieGroup& G,const GL& Gl)  {
+VectorSpace<DifferentialForm> derivations(const LieGroup& G,const StructureConstants& c,const GL& Gl)  {
 		auto gl=Gl.pForms(1);
+		if (c.is_rational())
+			if (auto basis=rational_derivations(c,gl,action_matrix(G,GLRepresentation<VectorField>(&Gl,G.e()),gl.GenericElement()),1))
+				return {basis->begin(),basis->end()};
 		auto generic_matrix =gl.GenericElement();
-		auto X=Xbrackets(G,GLRepresentation<VectorField>(&Gl,G.e()),generic_matrix);
-		lst eqns,sol;
+		auto X=Xbrackets(G,c,GLRepresentation<VectorField>(&Gl,G.e()),generic_matrix);
+		lst eqns;
 		GetCoefficients<VectorField>(eqns,X);
-		gl.GetSolutions(sol,eqns.begin(),eqns.end());		
+		exvector sol;
+		gl.GetSolutionsFromGenericSolution(sol,solve_by_components(eqns,lst{gl.coordinate_begin(),gl.coordinate_end()}));
 		return {sol.begin(),sol.end()};
 }
 
+VectorSpace<DifferentialForm> derivations(const LieGroup& G,const GL& Gl)  {
+		return derivations(G,StructureConstants{G},Gl);
+}
+
 
 /** Represents a vector space which is sandwiched between a smaller and a larger subspace.
 */
@@ -65,25 +277,68 @@ struct VectorSpaceBetween {
 };
 
 /** For a Lie group with parameters, return a VectorSpaceBetween object representing the derivations
-	@param G a Lie group of dimension n, with or without parameters
-	@param Gl The Lie algebra of GL(n,R), acting on the Lie algebra of g through the identification g=R^n given by the standard coframe of g
+	@param c The structure constants of a Lie group G of dimension n, with or without parameters
+	@param gl The space of 1-forms on GL(n,R)
+	@param a The matrix of the generic element of gl acting on the Lie algebra of G, as returned by action_matrix
+	@param threads The number of threads used to solve the equations of different weight spaces, if G has no parameters
 	@result A VectorSpaceBetween representing the subspace of Gl corresponding to the space of derivations
 	
-	The exact space of derivations corresponds to solutions of a linear system depending on parameters. This function computes the space of solutions of a subset of the equations that do not depend on a parameter and the space of elements that satisfy the equations for all values of the parameters
+	The exact space of derivations corresponds to solutions of a linear system depending on parameters. This function computes the space of solutions of a subset of the equations that do not depend on a parameter and the space of elements that satisfy the equations for all values of the parameters. If G has no parameters, the two spaces coincide and are computed exactly from the sparse equations. The equations are read off the components of Xbracket, so the only symbolic action of gl is the one encoded in a.
+
+	In either case, the equations are split into independent blocks according to the weights of the torus of diagonal derivations, @sa weight_blocks. With parameters, the blocks are solved one after the other, since GiNaC is not thread-safe.
 */	
 
 template<typename Parameter>
-VectorSpaceBetween derivations_parametric(const LieGroup& G,const GL& Gl)  {
-		auto gl=Gl.pForms(1);
-		auto generic_matrix =gl.GenericElement();
-		auto X=Xbrackets(G,GLRepresentation<VectorField>(&Gl,G.e()),generic_matrix);
-		lst eqns,sol;
-		GetCoefficients<VectorField>(eqns,X);
-		Wedge::linear_impl::LinearEquationsWithParameters<VectorSpace<DifferentialForm>::Coordinate,Parameter> linear_eqns{eqns,lst{gl.coordinate_begin(),gl.coordinate_end()}};
-		linear_eqns.eliminate_linear_equations();
+VectorSpaceBetween derivations_parametric(const StructureConstants& c,const VectorSpace<DifferentialForm>& gl, const exvector& a, int threads=1)  {
+		if (auto basis=rational_derivations(c,gl,a,threads)) {
+			VectorSpaceBetween result;
+			result.basis_of_larger_space=result.basis_of_smaller_space=*basis;
+			return result;
+		}
+		exvector coordinates{gl.coordinate_begin(),gl.coordinate_end()};
+		auto action=rational_action(gl,a);
+		Blocks blocks=action? weight_blocks(c,*action,coordinates.size()) : Blocks{int(coordinates.size())};
+		if (!action)		//no grading is known: a single block
+			for (int x=1;x<coordinates.size();++x) blocks.merge(x,0);
+		vector<pair<ex,int>> eqns;		//each equation with a coordinate appearing in it
+		for (int i=0;i<c.dimension();++i)
+		for (int j=i+1;j<c.dimension();++j)
+			for (auto& component: Xbracket(c,a,i,j)) {
+				ex eq=component.expand();
+				if (eq.is_zero()) continue;
+				int first=-1;
+				for (int x=0;x<coordinates.size();++x)
+					if (eq.has(coordinates[x])) {
+						if (first<0) first=x;
+						else blocks.merge(x,first);
+					}
+				eqns.emplace_back(eq,first);
+			}
+		map<int,pair<lst,lst>> systems;		//the equations and the coordinates of each block
+		for (int x=0;x<coordinates.size();++x) systems[blocks.block(x)].second.append(coordinates[x]);
+		for (auto& eq: eqns) systems[eq.second<0? blocks.block(0) : blocks.block(eq.second)].first.append(eq.first);
+		lst solution, always_solution;
+		for (auto& system: systems) {
+			Wedge::linear_impl::LinearEquationsWithParameters<VectorSpace<DifferentialForm>::Coordinate,Parameter> linear_eqns{system.second.first,system.second.second};
+			linear_eqns.eliminate_linear_equations();
+			for (auto x: linear_eqns.solution()) solution.append(x);
+			for (auto x: linear_eqns.always_solution()) always_solution.append(x);
+		}
 		VectorSpaceBetween result;
-		gl.GetSolutionsFromGenericSolution(result.basis_of_larger_space,linear_eqns.solution());
-		gl.GetSolutionsFromGenericSolution(result.basis_of_smaller_space,linear_eqns.always_solution());
+		gl.GetSolutionsFromGenericSolution(result.basis_of_larger_space,solution);
+		gl.GetSolutionsFromGenericSolution(result.basis_of_smaller_space,always_solution);
 		return result;
 }
+
+/** @overload */
+template<typename Parameter>
+VectorSpaceBetween derivations_parametric(const LieGroup& G,const StructureConstants& c,const GL& Gl, int threads=1)  {
+		auto gl=Gl.pForms(1);
+		return derivations_parametric<Parameter>(c,gl,action_matrix(G,GLRepresentation<VectorField>(&Gl,G.e()),gl.GenericElement()),threads);
+}
+
+template<typename Parameter>
+VectorSpaceBetween derivations_parametric(const LieGroup& G,const GL& Gl)  {
+		return derivations_parametric<Parameter>(G,StructureConstants{G},Gl);
+}
 #endif
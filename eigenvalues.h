@@ -0,0 +1,156 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EIGENVALUES_H
+#define EIGENVALUES_H
+
+#include <wedge/wedge.h>
+
+using namespace GiNaC;
+using namespace std;
+
+/** The indeterminate of the characteristic and minimal polynomials; it is distinct from the parameters of the Lie algebras even if they have the same name */
+const symbol& polynomial_variable() {
+	static symbol t{"t"};
+	return t;
+}
+
+/** The eigenvalue analysis of a square matrix whose entries lie in Q or in the field Q(parameters)
+
+	Semisimplicity and eigenvalues are relative to Q(parameters), so they hold for generic values of the parameters.
+*/
+struct EigenvalueAnalysis {
+	ex characteristic_polynomial;				///< det(tI-N), as a polynomial in t=polynomial_variable()
+	ex minimal_polynomial;							///< the monic polynomial in t of least degree that annihilates N
+	bool semisimple;										///< true if the minimal polynomial is squarefree, i.e. N is diagonalizable over the algebraic closure
+	vector<pair<ex,int>> eigenvalues;		///< the eigenvalues in Q(parameters), with their multiplicities as roots of the characteristic polynomial
+	exvector irrational_factors;				///< the irreducible factors of the characteristic polynomial of degree greater than one
+	vector<exvector> diagonalizing_basis;	///< if N is diagonalizable over Q(parameters), a basis of eigenvectors, ordered as the eigenvalues; empty otherwise
+	bool diagonalizable() const {return semisimple && irrational_factors.empty();}
+/** The eigenvalues of the elements of diagonalizing_basis, in the same order */
+	exvector diagonal() const {
+		exvector result;
+		for (auto& eigenvalue: eigenvalues)
+			for (int i=0;i<eigenvalue.second;++i) result.push_back(eigenvalue.first);
+		return result;
+	}
+};
+
+/** Return the matrix p(N)
+	@param p A polynomial in polynomial_variable(), with coefficients in Q(parameters)
+	@param N A square matrix
+*/
+matrix evaluate_polynomial(const ex& p, const matrix& N) {
+	auto& t=polynomial_variable();
+	int n=N.rows();
+	ex polynomial=p.expand();
+	matrix result(n,n);
+	for (int d=polynomial.degree(t);d>=0;--d) {
+		result=result.mul(N);
+		ex coefficient=polynomial.coeff(t,d);
+		for (int i=0;i<n;++i) result(i,i)+=coefficient;
+		for (int i=0;i<n;++i)
+		for (int j=0;j<n;++j)
+			result(i,j)=result(i,j).normal();
+	}
+	return result;
+}
+
+/** Return a basis of the kernel of a square matrix with entries in Q(parameters), as a list of column vectors */
+vector<exvector> kernel_of_matrix(const matrix& M) {
+	int n=M.rows();
+	matrix unknowns(n,1), zero(n,1);
+	exmap all_zero;
+	for (int i=0;i<n;++i) {
+		unknowns(i,0)=symbol{};
+		all_zero[unknowns(i,0)]=0;
+	}
+	auto solution=M.solve(unknowns,zero);
+	vector<exvector> result;
+	for (int j=0;j<n;++j) {
+		if (!solution(j,0).is_equal(unknowns(j,0))) continue;		//not a free unknown
+		exmap x_j_to_one=all_zero;
+		x_j_to_one[unknowns(j,0)]=1;
+		exvector v;
+		for (int i=0;i<n;++i) v.push_back(solution(i,0).subs(x_j_to_one).normal());
+		result.push_back(move(v));
+	}
+	return result;
+}
+
+/** Compute the characteristic and minimal polynomials, the eigenvalues and, when it exists, a diagonalizing basis of a square matrix
+	@param N A square matrix with entries in Q or in Q(parameters)
+	@return The eigenvalue analysis of N
+
+	The characteristic polynomial is factored over Q[parameters,t]; by Gauss' lemma, its factors of positive degree in t are irreducible over Q(parameters). The minimal polynomial is the product of the same factors, with the exponents reduced as long as the product annihilates N; N is semisimple if and only if all exponents are one. Linear factors give the eigenvalues, and the eigenvectors are computed as the kernels of N-mu I.
+*/
+EigenvalueAnalysis eigenvalue_analysis(const matrix& N) {
+	auto& t=polynomial_variable();
+	int n=N.rows();
+	EigenvalueAnalysis result;
+	result.characteristic_polynomial=N.charpoly(t).normal();
+	vector<pair<ex,int>> factors;
+	auto add_factor=[&factors,&t] (ex f) {
+		int multiplicity=1;
+		if (is_a<power>(f)) {
+			multiplicity=ex_to<numeric>(f.op(1)).to_int();
+			f=f.op(0);
+		}
+		if (f.degree(t)>0) factors.emplace_back(f,multiplicity);
+	};
+	ex factored=factor(result.characteristic_polynomial.numer());		//the denominator does not depend on t
+	if (is_a<mul>(factored))
+		for (auto f: factored) add_factor(f);
+	else add_factor(factored);
+	vector<matrix> factors_at_N;
+	for (auto& f: factors) factors_at_N.push_back(evaluate_polynomial(f.first,N));
+	auto annihilates=[&] (const vector<int>& exponents) {
+		auto product=ex_to<matrix>(unit_matrix(n));
+		for (int i=0;i<factors.size();++i)
+			for (int k=0;k<exponents[i];++k) product=product.mul(factors_at_N[i]);
+		for (int i=0;i<n;++i)
+		for (int j=0;j<n;++j)
+			if (!product(i,j).normal().is_zero()) return false;
+		return true;
+	};
+	vector<int> exponents;
+	for (auto& f: factors) exponents.push_back(f.second);
+	for (int i=0;i<factors.size();++i)
+		while (exponents[i]>1) {
+			--exponents[i];
+			if (!annihilates(exponents)) {++exponents[i]; break;}
+		}
+	result.minimal_polynomial=1;
+	result.semisimple=true;
+	for (int i=0;i<factors.size();++i) {
+		result.minimal_polynomial*=pow(factors[i].first/factors[i].first.lcoeff(t),exponents[i]);
+		if (exponents[i]>1) result.semisimple=false;
+		if (factors[i].first.degree(t)>1) result.irrational_factors.push_back(factors[i].first);
+		else result.eigenvalues.emplace_back((-factors[i].first.coeff(t,0)/factors[i].first.coeff(t,1)).normal(),factors[i].second);
+	}
+	result.minimal_polynomial=result.minimal_polynomial.expand().normal();
+	if (result.diagonalizable())
+		for (auto& eigenvalue: result.eigenvalues) {
+			auto eigenvectors=kernel_of_matrix(N.sub(ex_to<matrix>(unit_matrix(n)).mul_scalar(eigenvalue.first)));
+			if (eigenvectors.size()!=eigenvalue.second) throw std::logic_error("geometric multiplicity of eigenvalue differs from algebraic multiplicity for a semisimple matrix");
+			result.diagonalizing_basis.insert(result.diagonalizing_basis.end(),eigenvectors.begin(),eigenvectors.end());
+		}
+	return result;
+}
+
+#endif
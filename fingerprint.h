@@ -0,0 +1,388 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <tuple>
+#include <sstream>
+#include <optional>
+#include <algorithm>
+#include <numeric>
+#include "modular.h"
+
+/** Lie algebras of dimension up to this are relabeled canonically, @sa canonical_relabeling; the cost grows as n! */
+constexpr int max_relabeling_dimension=8;
+
+/** The structure constants of a Lie algebra with rational structure constants, read from their normal form without involving GiNaC */
+struct RationalStructureConstants {
+	int n=0;
+	std::vector<std::tuple<int,int,int,mpq_class>> components;		///< the nonzero c_ij^k with i<j, as (i,j,k,c_ij^k) with zero-based indices
+};
+
+/** Read structure constants from their normal form
+	@param normal_form A string in the format returned by StructureConstants::normal_form
+	@return The structure constants, or nothing if the string is not in this format or some structure constant is not a rational number, as for Lie algebras with parameters
+*/
+inline std::optional<RationalStructureConstants> parse_normal_form(const std::string& normal_form) {
+	std::stringstream s{normal_form};
+	RationalStructureConstants c;
+	std::string item;
+	if (!getline(s,item,';')) return std::nullopt;
+	try {
+		size_t end=0;
+		c.n=std::stoi(item,&end);
+		if (end!=item.size() || c.n<=0) return std::nullopt;
+		while (getline(s,item,';')) {
+			int i,j,k;
+			char comma1,comma2,colon;
+			std::stringstream component{item};
+			std::string coefficient;
+			if (!(component>>i>>comma1>>j>>comma2>>k>>colon>>coefficient) || comma1!=',' || comma2!=',' || colon!=':') return std::nullopt;
+			if (i<1 || i>=j || j>c.n || k<1 || k>c.n) return std::nullopt;
+			mpq_class value;
+			if (value.set_str(coefficient,10)) return std::nullopt;
+			value.canonicalize();
+			c.components.emplace_back(i-1,j-1,k-1,value);
+		}
+	}
+	catch (const std::exception&) {return std::nullopt;}
+	return c;
+}
+
+/** A subspace of F_p^n, kept as a basis in reduced row echelon form */
+class ModularSubspace {
+	uint32_t p;
+	int n;
+	std::vector<std::vector<uint64_t>> rows;
+	std::vector<int> pivots;		///< the column of the leading coefficient of each row
+public:
+	ModularSubspace(int n, uint32_t p) : p{p}, n{n} {}
+/** Return the remainder of a vector modulo the subspace, which is zero in the pivot columns */
+	std::vector<uint64_t> reduce(std::vector<uint64_t> v) const {
+		for (int r=0;r<rows.size();++r)
+			if (uint64_t a=v[pivots[r]])
+				for (int i=0;i<n;++i) v[i]=(v[i]+(p-a)*rows[r][i])%p;
+		return v;
+	}
+/** Add a vector to the subspace
+	@return true if the dimension increased
+*/
+	bool add(std::vector<uint64_t> v) {
+		v=reduce(std::move(v));
+		auto leading=std::find_if(v.begin(),v.end(),[] (uint64_t x) {return x!=0;});
+		if (leading==v.end()) return false;
+		int column=leading-v.begin();
+		uint64_t inverse=inverse_mod(*leading,p);
+		for (auto& x: v) x=x*inverse%p;
+		for (auto& row: rows)
+			if (uint64_t a=row[column])
+				for (int i=0;i<n;++i) row[i]=(row[i]+(p-a)*v[i])%p;
+		rows.push_back(std::move(v));
+		pivots.push_back(column);
+		return true;
+	}
+	int dimension() const {return rows.size();}
+	const std::vector<std::vector<uint64_t>>& basis() const {return rows;}
+/** Return a basis of the vectors x with r.x=0 for all r in the subspace */
+	std::vector<std::vector<uint64_t>> annihilator() const {
+		std::vector<std::vector<uint64_t>> result;
+		for (int free=0;free<n;++free) {
+			if (std::count(pivots.begin(),pivots.end(),free)) continue;
+			std::vector<uint64_t> x(n);
+			x[free]=1;
+			for (int r=0;r<rows.size();++r) x[pivots[r]]=(p-rows[r][free])%p;
+			result.push_back(std::move(x));
+		}
+		return result;
+	}
+};
+
+/** Invariants of a Lie algebra with rational structure constants that do not depend on the choice of basis, computed modulo a prime
+
+	Isomorphic Lie algebras have the same fingerprint; Lie algebras with the same fingerprint are likely, but not necessarily, isomorphic. The dimensions are those over F_p, which coincide with those over Q unless the prime is unlucky, in which case the same prime is unlucky for all Lie algebras isomorphic over Q via a matrix whose entries and determinant are coprime to p.
+*/
+struct Fingerprint {
+	int dimension=0;
+	std::vector<int> lower_central;		///< dimensions of g, [g,g], [g,[g,g]], ..., up to the first repetition
+	std::vector<int> derived;					///< dimensions of g, [g,g], [[g,g],[g,g]], ..., up to the first repetition
+	std::vector<int> upper_central;		///< dimensions of the center, the second center, ..., up to the first repetition
+	int derivations=0;								///< the dimension of the derivation algebra
+	std::string to_string() const {
+		auto list=[] (const std::vector<int>& v) {
+			std::string result;
+			for (int x: v) result+=(result.empty()? "" : ",")+std::to_string(x);
+			return result;
+		};
+		return "dim="+std::to_string(dimension)+" lcs="+list(lower_central)+" ds="+list(derived)+" ucs="+list(upper_central)+" der="+std::to_string(derivations);
+	}
+};
+
+/** The structure constants of a Lie algebra modulo a prime, as a dense tensor */
+class ModularLieAlgebra {
+	uint32_t p;
+	int n;
+	std::vector<uint64_t> c;		//c[(i*n+j)*n+k] is c_ij^k modulo p
+	ModularLieAlgebra(int n, uint32_t p) : p{p}, n{n}, c(n*n*n) {}
+public:
+/** Reduce structure constants modulo a prime
+	@return The reduction, or nothing if p divides some denominator
+*/
+	static std::optional<ModularLieAlgebra> reduce(const RationalStructureConstants& constants, uint32_t p) {
+		ModularLieAlgebra g{constants.n,p};
+		for (auto& component: constants.components) {
+			auto& [i,j,k,value]=component;
+			uint32_t denominator=mpz_fdiv_ui(value.get_den_mpz_t(),p);
+			if (!denominator) return std::nullopt;
+			uint64_t x=uint64_t{mpz_fdiv_ui(value.get_num_mpz_t(),p)}*inverse_mod(denominator,p)%p;
+			g.c[(i*g.n+j)*g.n+k]=x;
+			g.c[(j*g.n+i)*g.n+k]=(p-x)%p;
+		}
+		return g;
+	}
+	int dimension() const {return n;}
+	uint32_t prime() const {return p;}
+	std::vector<uint64_t> bracket(const std::vector<uint64_t>& u, const std::vector<uint64_t>& v) const {
+		std::vector<uint64_t> result(n);
+		for (int i=0;i<n;++i) {
+			if (!u[i]) continue;
+			for (int j=0;j<n;++j) {
+				if (!v[j]) continue;
+				uint64_t uv=u[i]*v[j]%p;
+				for (int k=0;k<n;++k)
+					if (uint64_t x=c[(i*n+j)*n+k]) result[k]=(result[k]+uv*x)%p;
+			}
+		}
+		return result;
+	}
+	std::vector<uint64_t> basis_vector(int i) const {
+		std::vector<uint64_t> e(n);
+		e[i]=1;
+		return e;
+	}
+/** Return the span of the brackets [x,y] with x in one list and y in another */
+	ModularSubspace bracket(const std::vector<std::vector<uint64_t>>& X, const std::vector<std::vector<uint64_t>>& Y) const {
+		ModularSubspace result{n,p};
+		for (auto& x: X)
+			for (auto& y: Y) result.add(bracket(x,y));
+		return result;
+	}
+	std::vector<std::vector<uint64_t>> basis() const {
+		std::vector<std::vector<uint64_t>> result;
+		for (int i=0;i<n;++i) result.push_back(basis_vector(i));
+		return result;
+	}
+/** Return the subspace {x : [x,g] is contained in Z} */
+	ModularSubspace preimage_of_center(const ModularSubspace& Z) const {
+		ModularSubspace equations{n,p};		//rows r with r.x=0
+		for (int j=0;j<n;++j) {
+			std::vector<std::vector<uint64_t>> columns;		//the reduction of [e_i,e_j] modulo Z, for each i
+			for (int i=0;i<n;++i) columns.push_back(Z.reduce(bracket(basis_vector(i),basis_vector(j))));
+			for (int l=0;l<n;++l) {
+				std::vector<uint64_t> row(n);
+				for (int i=0;i<n;++i) row[i]=columns[i][l];
+				equations.add(std::move(row));
+			}
+		}
+		ModularSubspace result{n,p};
+		for (auto& x: equations.annihilator()) result.add(x);
+		return result;
+	}
+/** Return the dimension of the space of derivations, from the equations D[e_i,e_j]=[De_i,e_j]+[e_i,De_j] in the unknowns a_li, indexed by l*n+i, where a_li is the coefficient of e_l in De_i */
+	int derivations() const {
+		ModularSubspace equations{n*n,p};
+		for (int i=0;i<n;++i)
+		for (int j=i+1;j<n;++j)
+			for (int k=0;k<n;++k) {
+				std::vector<uint64_t> row(n*n);
+				for (int m=0;m<n;++m) {
+					row[k*n+m]=(row[k*n+m]+c[(i*n+j)*n+m])%p;				//D[e_i,e_j] contains c_ij^m a_km e_k
+					row[m*n+i]=(row[m*n+i]+p-c[(m*n+j)*n+k])%p;			//[De_i,e_j] contains a_mi c_mj^k e_k
+					row[m*n+j]=(row[m*n+j]+p-c[(i*n+m)*n+k])%p;			//[e_i,De_j] contains a_mj c_im^k e_k
+				}
+				equations.add(std::move(row));
+			}
+		return n*n-equations.dimension();
+	}
+};
+
+/** Compute the fingerprint of a Lie algebra
+	@param c The structure constants of a Lie algebra
+	@return The fingerprint, computed modulo the first prime in word_primes that divides no denominator
+*/
+inline Fingerprint fingerprint(const RationalStructureConstants& c) {
+	std::optional<ModularLieAlgebra> g;
+	for (auto p: word_primes)
+		if ((g=ModularLieAlgebra::reduce(c,p))) break;
+	if (!g) throw std::runtime_error("structure constants with denominators divisible by all primes");
+	Fingerprint result;
+	result.dimension=c.n;
+	auto append_until_repeated=[] (std::vector<int>& dimensions, int dimension) {
+		bool repeated=!dimensions.empty() && dimensions.back()==dimension;
+		if (!repeated) dimensions.push_back(dimension);
+		return !repeated;
+	};
+	auto g_basis=g->basis();
+	auto lower=g_basis;
+	result.lower_central.push_back(c.n);
+	do lower=g->bracket(g_basis,lower).basis();
+	while (append_until_repeated(result.lower_central,lower.size()));
+	auto derived=g_basis;
+	result.derived.push_back(c.n);
+	do derived=g->bracket(derived,derived).basis();
+	while (append_until_repeated(result.derived,derived.size()));
+	ModularSubspace center{c.n,g->prime()};
+	do center=g->preimage_of_center(center);
+	while (append_until_repeated(result.upper_central,center.dimension()));
+	result.derivations=g->derivations();
+	return result;
+}
+
+/** A relabeling of the basis of a Lie algebra that puts its structure constants in a canonical form */
+struct Relabeling {
+	std::string canonical_form;		///< the relabeled structure constants, in the format of StructureConstants::normal_form
+	std::vector<int> permutation;		///< the zero-based index of the element e_i after the relabeling, for each i
+};
+
+/** Relabel the basis of a Lie algebra so that its structure constants are minimal among those obtained by permuting the basis
+	@param c The structure constants of a Lie algebra
+	@return The relabeling, or nothing if the dimension exceeds max_relabeling_dimension
+
+	Two Lie algebras have the same canonical form if and only if one is obtained from the other by permuting the basis. Each permutation is tried; coefficients are compared through their rank among the values appearing in the structure constants, so that only integers are compared.
+*/
+inline std::optional<Relabeling> canonical_relabeling(const RationalStructureConstants& c) {
+	if (c.n>max_relabeling_dimension) return std::nullopt;
+	std::vector<mpq_class> values;
+	for (auto& component: c.components) {
+		values.push_back(std::get<3>(component));
+		values.push_back(-std::get<3>(component));
+	}
+	std::sort(values.begin(),values.end());
+	values.erase(std::unique(values.begin(),values.end()),values.end());
+	auto rank=[&values] (const mpq_class& x) {return static_cast<int>(std::lower_bound(values.begin(),values.end(),x)-values.begin());};
+	std::vector<std::array<int,5>> components;		//i,j,k, rank of c_ij^k and of -c_ij^k
+	for (auto& [i,j,k,value]: c.components) components.push_back({{i,j,k,rank(value),rank(-value)}});
+	std::vector<int> permutation(c.n);
+	std::iota(permutation.begin(),permutation.end(),0);
+	std::vector<std::array<int,4>> best, relabeled(components.size());
+	std::vector<int> best_permutation;
+	do {
+		for (int r=0;r<components.size();++r) {
+			auto& x=components[r];
+			int i=permutation[x[0]], j=permutation[x[1]], k=permutation[x[2]];
+			relabeled[r]=i<j? std::array<int,4>{{i,j,k,x[3]}} : std::array<int,4>{{j,i,k,x[4]}};
+		}
+		std::sort(relabeled.begin(),relabeled.end());
+		if (best_permutation.empty() || relabeled<best) {
+			best=relabeled;
+			best_permutation=permutation;
+		}
+	} while (std::next_permutation(permutation.begin(),permutation.end()));
+	std::stringstream s;
+	s<<c.n;
+	for (auto& x: best) s<<';'<<x[0]+1<<','<<x[1]+1<<','<<x[2]+1<<':'<<values[x[3]].get_str();
+	return Relabeling{s.str(),best_permutation};
+}
+
+/** A Lie algebra found to coincide with one seen before */
+struct Duplicate {
+	std::string of;						///< the name of the Lie algebra seen before
+	std::vector<int> relabeling;		///< the zero-based index of the element of the basis of the other Lie algebra corresponding to each e_i; empty if the structure constants are identical
+	bool stored=false;					///< true if the other Lie algebra is in the result store
+};
+
+/** Keeps track of the Lie algebras seen so far, recognizing those with identical structure constants, those obtained by permuting the basis, and those with the same fingerprint
+
+	Comparing a Lie algebra with those seen before and adding it are separate operations, so that a Lie algebra can be added only once its results are known. Since relabeling canonically is expensive, Lie algebras are grouped by fingerprint, and the canonical relabelings are only computed within a group with more than one member, @sa canonical_relabeling.
+*/
+class Deduplicator {
+	struct Known {
+		std::string name;
+		bool stored;
+	};
+/** A Lie algebra with rational structure constants seen before, whose canonical relabeling is computed when first needed */
+	struct Candidate : Known {
+		RationalStructureConstants constants;
+		mutable bool relabeled=false;
+		mutable std::optional<Relabeling> relabeling;
+		Candidate(Known known, RationalStructureConstants constants, std::optional<Relabeling> relabeling) :
+			Known{std::move(known)}, constants{std::move(constants)}, relabeled{relabeling.has_value()}, relabeling{std::move(relabeling)} {}
+		const std::optional<Relabeling>& canonical_relabeling() const {
+			if (!relabeled) relabeling=::canonical_relabeling(constants);
+			relabeled=true;
+			return relabeling;
+		}
+	};
+	std::map<std::string,Known> by_normal_form;
+	std::map<std::string,std::vector<Candidate>> by_fingerprint;
+public:
+/** The result of comparing a Lie algebra with those seen before */
+	struct Outcome {
+		std::optional<Duplicate> duplicate;		///< set if the Lie algebra coincides with one seen before, up to relabeling
+		std::optional<Fingerprint> fingerprint;	///< set if the structure constants are rational, also for duplicates
+		std::optional<std::string> same_invariants_as;		///< the first Lie algebra seen before with the same fingerprint, if it is not a duplicate
+		std::optional<Relabeling> relabeling;		///< the canonical relabeling, if it was needed for the comparison, i.e. some Lie algebra seen before has the same fingerprint, and the dimension is small enough
+	};
+/** Compare a Lie algebra with those seen before, without adding it to them
+	@param normal_form The structure constants, as returned by StructureConstants::normal_form
+*/
+	Outcome compare(const std::string& normal_form) const {
+		Outcome outcome;
+		auto c=parse_normal_form(normal_form);
+		if (c) outcome.fingerprint=fingerprint(*c);
+		if (auto i=by_normal_form.find(normal_form);i!=by_normal_form.end()) {
+			outcome.duplicate=Duplicate{i->second.name,{},i->second.stored};
+			return outcome;
+		}
+		if (!c) return outcome;
+		auto group=by_fingerprint.find(outcome.fingerprint->to_string());
+		if (group==by_fingerprint.end()) return outcome;
+		outcome.relabeling=canonical_relabeling(*c);
+		if (outcome.relabeling)
+			for (auto& candidate: group->second) {
+				auto& relabeling=candidate.canonical_relabeling();
+				if (!relabeling || relabeling->canonical_form!=outcome.relabeling->canonical_form) continue;
+				std::vector<int> inverse(c->n);
+				for (int k=0;k<c->n;++k) inverse[relabeling->permutation[k]]=k;
+				std::vector<int> composition;
+				for (int k: outcome.relabeling->permutation) composition.push_back(inverse[k]);
+				outcome.duplicate=Duplicate{candidate.name,composition,candidate.stored};
+				return outcome;
+			}
+		outcome.same_invariants_as=group->second.front().name;
+		return outcome;
+	}
+/** Compare a Lie algebra with those seen before; unless it is a duplicate, it is then added to them
+	@param name The name of the Lie algebra
+	@param normal_form The structure constants, as returned by StructureConstants::normal_form
+	@param stored True if the Lie algebra is in the result store
+*/
+	Outcome add(const std::string& name, const std::string& normal_form, bool stored=false) {
+		auto outcome=compare(normal_form);
+		if (outcome.duplicate) return outcome;
+		by_normal_form.emplace(normal_form,Known{name,stored});
+		if (outcome.fingerprint) by_fingerprint[outcome.fingerprint->to_string()].emplace_back(Known{name,stored},*parse_normal_form(normal_form),outcome.relabeling);
+		return outcome;
+	}
+};
+
+#endif
@@ -16,171 +16,696 @@
     along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include "derivations.h"
+#include <fstream>
+#include "gleipnir.h"
+#include "structureconstants.h"
 #include "horizontal.h"
 #include "classification.h"
+#include "options.h"
+#include "batch.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "json.h"
+#include "store.h"
+#include "server.h"
+#include "progress.h"
+#include "costmodel.h"
+#include "fingerprint.h"
 
+/** Print the Nikolayevsky derivation of a Lie algebra depending on one parameter, for generic values of the parameter
+	@param generic The derivation, as computed by study
+	@param os The stream where the results are printed
+*/
+void print_generic_nikolayevsky(const GenericNikolayevskyResult& generic, ostream& os) {
+	if (!generic.computed) {
+		os<<"generic Nikolayevsky derivation: cannot compute by specialization"<<endl;
+		return;
+	}
+	os<<"generic Nikolayevsky derivation: "<<generic.N;
+	if (!generic.denominator.is_equal(1)) os<<" for "<<generic.parameter<<" not a root of "<<generic.denominator;
+	os<<", derivations of dimension "<<generic.dimension_of_derivations;
+	if (generic.exceptional.empty()) os<<"; no rational exceptional values";
+	else {
+		os<<"; exceptional values:";
+		for (auto& value: generic.exceptional) os<<" "<<value;
+	}
+	if (!generic.possibly_exceptional.is_equal(1)) os<<"; dimension not decided at the roots of "<<generic.possibly_exceptional;
+	os<<endl;
+}
 
-/** Return the linear equations corresponding to Tr(ND)=D for all D in some subspace of gl
-	@param N A generic element of gl, depending on parameters
-	@param subspace A subspace of gl
-	@param gl The Lie algebra of the general Lie group	
-	@return The linear equations corresponding to Tr(ND)=D for all D in subspace
+/** Print the results of the study of a Lie group on a stream
+	@param G A Lie group
+	@param result The results, as computed by study
+	@param os The stream where the results are printed
+	@param record An object where the results are recorded in textual form
 */
-	
-exvector nikolayevsky_equations(ex N, const exvector& subspace, const GL& gl) {
-	set<ex,ex_is_less> eqns;
-	auto N_as_matrix=gl.glToMatrix(N);
-	for (auto e: subspace) {
-		auto M=gl.glToMatrix(e);
-		eqns.insert(N_as_matrix.mul(M).sub(M).trace());
-	}
-	return {eqns.begin(),eqns.end()};
-}
-
-/** An affine space N+W in gl(n,R) */
-struct AffineSpaceInGl {
-	ex N;
-	VectorSpace<DifferentialForm> W;
-};
-
-/** Return the affine space N+W of derivations satisfying tr(ND)=tr(D) for all derivations D
-	@param G a Lie group of dimension n without parameters
-	@param gl The Lie algebra of GL(n,R).
-	@return an AffineSpaceInGl object representing the affine space N+W
-	
-	The computation is performed by computing the space of derivations exactly
-*/
-AffineSpaceInGl nikolayevsky_like_derivations(const LieGroup& G, const GL& gl) {
-	auto der=derivations(G,gl);
-	auto eqns=nikolayevsky_equations(der.GenericElement(),der.e(),gl);	
-	exvector solutions;
-	AffineSpaceInGl result;
-	der.GetSolutions(solutions,eqns.begin(),eqns.end(),&result.N);
-	result.W=VectorSpace<DifferentialForm>{solutions};
+void print_study(const LieGroup& G, const StudyResult& result, ostream& os, StudyRecord& record) {
+	os<<latex<<endl;
+	os<<"Lie algebra:"<<horizontal(G.StructureConstants())<<endl;
+	os<<"Nikolayevsky derivation: "<<result.nikolayevsky_description<<endl;	
+	if (result.generic_nikolayevsky) print_generic_nikolayevsky(*result.generic_nikolayevsky,os);
+	record.nikolayevsky=to_string_dflt(result.nikolayevsky);
+	record.derivation_when=to_string_dflt(result.nikolayevsky_when);
+	record.trace_form=to_string_dflt(result.trace_form);
+	for (auto& D: result.derivation_basis) record.derivation_basis+=to_string_dflt(D)+'\n';
+	for (auto& eigenvalue: result.eigenvalues) record.eigenvalues+=to_string_dflt(eigenvalue)+'\n';
+	os<<"trace form: "<<result.trace_form<<endl;
+	record.centralizer=to_string_dflt(result.generic_centralizer_element);
+	record.centralizer_dimension=std::to_string(result.centralizer.size());
+	record.derivations=to_string_dflt(result.generic_derivation);
+	os<<dflt;
+	os<<"generic derivation "<<result.generic_derivation<<endl;
+	os<<"derivation when the following are zero: "<<result.derivation_when<<endl;
+	os<<latex;
+	if (result.nikolayevsky_is_zero()) {os<<"Nikolayevsky derivation is zero"<<endl; return;}	
+	if (result.nikolayevsky_computed && result.centralizer.empty()) 
+	{
+		os<<"trivial centralizer"<<endl; 
+		return;
+	}
+	os<<"Centralizer contained in space of dimension "<<result.centralizer.size()<<endl;
+	os<<"generic element "<<result.generic_centralizer_element<<endl;
+	if (result.centralizer_derivation_when && !result.centralizer_derivation_when->empty())
+		os<<"derivation when the following are zero: "<<*result.centralizer_derivation_when<<endl;
+}
+
+/** Study a Lie group, reusing the results stored in a cache if present
+	@param G A Lie group
+	@param cache A cache of results, or nullptr
+	@param options The command line options; the equations for the derivations are solved in options.threads threads, and if options.specialize is positive and G depends on a parameter, the Nikolayevsky derivation is also computed by specializing the parameter in options.specialize threads, @sa StudyOptions
+	@param telemetry If not nullptr, set to the telemetry of the study; it is left empty on a cache hit
+	@return The results
+
+	On a cache hit, neither GL(n,R) nor any derivation is computed.
+*/
+StudyRecord study_group(const LieGroup& G, const ResultCache* cache, const Options& options, StudyTelemetry* telemetry=nullptr) {
+	StructureConstants c{G};
+	auto normal_form=c.normal_form();
+	if (options.specialize && !c.is_rational()) normal_form+=";specialize";		//the output contains an extra line
+	if (cache) 
+		if (auto record=cache->load(normal_form)) return *record;
+	StudyRecord record;
+	stringstream output;
+	auto result=study(G,StudyOptions{options.threads,options.specialize});
+	if (telemetry) *telemetry=result.telemetry;
+	print_study(G,result,output,record);
+	record.structure_constants=normal_form;
+	record.output=output.str();
+	if (cache) cache->store(record);
+	return record;
+}
+
+/** Print the dimension of the derivation algebra of a Lie group, computed modulo primes without any symbolic computation
+	@param G A Lie group
+	@param name The name of G, printed before the dimension
+*/
+void screen_group(const LieGroup& G, const string& name) {
+	auto dimension=derivation_dimension_modulo_primes(G);
+	cout<<name<<'\t';
+	if (dimension) cout<<*dimension<<endl;
+	else cout<<"depends on parameters"<<endl;
+}
+
+/** Return the Lie algebras in a result store, as the Lie algebras seen before a run, @sa Deduplicator
+	@param store A result store, or nullptr
+*/
+Deduplicator known_algebras(ResultStore* store) {
+	Deduplicator known;
+	if (store)
+		for (auto& name: store->names())
+			if (auto structure_constants=store->structure_constants(name)) known.add(name,*structure_constants,true);
+	return known;
+}
+
+/** Return a description of a duplicate, naming the Lie algebra seen before and the correspondence between the bases */
+string description(const Duplicate& duplicate) {
+	if (duplicate.relabeling.empty()) return "identical to "+duplicate.of;
+	vector<string> images;
+	for (int i: duplicate.relabeling) images.push_back("e"+std::to_string(i+1));
+	return "isomorphic to "+duplicate.of+", mapping e1,...,e"+std::to_string(images.size())+" to "+horizontal(images);
+}
+
+/** Print the invariants of a Lie group computed modulo a prime, flagging it if it coincides with a Lie group seen before up to relabeling, or has the same invariants, @sa Deduplicator
+	@param G A Lie group
+	@param name The name of G, printed before the invariants
+	@param known The Lie groups seen before, to which G is added
+*/
+void fingerprint_group(const LieGroup& G, const string& name, Deduplicator& known) {
+	auto outcome=known.add(name,StructureConstants{G}.normal_form());
+	cout<<name<<'\t';
+	if (outcome.fingerprint) cout<<outcome.fingerprint->to_string();
+	else cout<<"depends on parameters";
+	if (outcome.duplicate) cout<<'\t'<<description(*outcome.duplicate);
+	else if (outcome.same_invariants_as) cout<<'\t'<<"same invariants as "<<*outcome.same_invariants_as;
+	cout<<endl;
+}
+
+/** Compare a Lie group with those seen before, reporting on standard error if it has the same invariants as one of them
+	@param known The Lie groups seen before; G is not added to them, so that it can be added once its study completes
+	@param name The name of G
+	@param G A Lie group
+	@return The Lie group seen before that coincides with G up to relabeling, if any
+*/
+optional<Duplicate> find_duplicate(const Deduplicator& known, const string& name, const LieGroup& G) {
+	auto outcome=known.compare(StructureConstants{G}.normal_form());
+	if (!outcome.duplicate && outcome.same_invariants_as) cerr<<name<<": same invariants as "<<*outcome.same_invariants_as<<", likely isomorphic"<<endl;
+	return outcome.duplicate;
+}
+
+/** Return a description of the outcome of a task that did not complete */
+string description(TaskStatus status, const Options& options) {
+	switch (status) {
+		case TaskStatus::timed_out: return "timed out after "+std::to_string(options.timeout)+" seconds";
+		case TaskStatus::out_of_memory: return "ran out of memory ("+std::to_string(options.memory)+" MB)";
+		default: return "failed";
+	}
+}
+
+/** Print the results of a Lie algebra on standard output, without flushing, and append them to the result store
+	@param name The name of the Lie algebra
+	@param record The results
+	@param options The command line options, which determine the output format
+	@param store A result store, or nullptr
+	@param by_normal_form If true, the record is stored under the normal form of the structure constants rather than under name
+*/
+void print_record(const string& name, const StudyRecord& record, const Options& options, ResultStore* store, bool by_normal_form=false) {
+	if (options.json) write_json(cout,name,record);
+	else cout<<record.output;
+	if (store) store->append(by_normal_form? record.structure_constants : name,record);
+}
+
+/** Print the outcome of a Lie algebra that could not be studied on standard output, without flushing
+	@param name The name of the Lie algebra
+	@param lie_algebra The structure constants of the Lie algebra, in the form they were given
+	@param index The position of the Lie algebra in the classification or in the input, starting from 0
+	@param reason A description of the outcome
+	@param options The command line options, which determine the output format
+*/
+void print_failure(const string& name, const string& lie_algebra, int index, const string& reason, const Options& options) {
+	if (options.json) write_json_failure(cout,name,reason);
+	else cout<<latex<<'\n'<<"Lie algebra:"<<lie_algebra<<'\n'<<"entry "<<index+1<<" "<<reason<<'\n';
+}
+
+/** Print an entry that coincides with a Lie algebra seen before on standard output, without flushing
+
+	If the structure constants are identical to those of a Lie algebra in the result store, its results are printed as those of the entry; otherwise, the entry is printed with a reference to the other Lie algebra and the correspondence between the bases. Stored results are not transported through a relabeling, since the records hold the matrices and the output in textual form.
+	@param name The name of the Lie algebra
+	@param lie_algebra The structure constants of the Lie algebra, in the form they were given
+	@param duplicate The Lie algebra seen before
+	@param options The command line options, which determine the output format
+	@param store A result store, or nullptr
+	@param by_normal_form If true, the results of the entry are stored under the normal form of the structure constants rather than under name, @sa print_record
+*/
+void print_duplicate(const string& name, const string& lie_algebra, const Duplicate& duplicate, const Options& options, ResultStore* store, bool by_normal_form=false) {
+	if (duplicate.stored && duplicate.relabeling.empty() && store)
+		if (auto record=store->load(duplicate.of)) {
+			auto& key=by_normal_form? record->structure_constants : name;
+			print_record(name,*record,options,key!=duplicate.of? store : nullptr,by_normal_form);
+			return;
+		}
+	if (options.json) {
+		auto relabeling=duplicate.relabeling;
+		for (auto& i: relabeling) ++i;
+		write_json_duplicate(cout,name,duplicate.of,relabeling);
+	}
+	else cout<<latex<<'\n'<<"Lie algebra:"<<lie_algebra<<'\n'<<description(duplicate)<<'\n';
+}
+
+/** Return a record in the form written by write, followed by the telemetry of the study, so that they can be passed from a worker process to the parent */
+string serialize(const StudyRecord& record, const StudyTelemetry& telemetry={}) {
+	stringstream s;
+	write(s,record);
+	s<<serialize(telemetry);
+	return s.str();
+}
+
+/** Read a record returned by serialize
+	@param serialized The output of serialize
+	@param telemetry If not nullptr, set to the telemetry following the record
+*/
+StudyRecord deserialize(const string& serialized, StudyTelemetry* telemetry=nullptr) {
+	stringstream s{serialized};
+	StudyRecord record;
+	if (!read(s,record)) throw runtime_error("corrupted result");
+	if (telemetry) *telemetry=deserialize_telemetry(s);
+	return record;
+}
+
+/** Study a Lie group in a worker process, @sa study_group
+	@return The record and the telemetry, as returned by serialize
+*/
+string study_in_worker(const LieGroup& G, const ResultCache* cache, const Options& options) {
+	StudyTelemetry telemetry;
+	auto record=study_group(G,cache,options,&telemetry);
+	return serialize(record,telemetry);
+}
+
+/** Record the time taken to study a Lie algebra in the cost model, unless the results were taken from the cache
+	@param description The Lie algebra, as given in the classification or in the input
+	@param status The outcome of the study
+	@param telemetry The telemetry of the study, if it completed
+	@param options The command line options; a Lie algebra that timed out is recorded as taking options.timeout seconds, so that later runs start it early
+	@param costs The cost model
+*/
+void record_time(string_view description, TaskStatus status, const StudyTelemetry& telemetry, const Options& options, CostModel& costs) {
+	if (status==TaskStatus::completed && !telemetry.stage_seconds.empty()) costs.record(description,telemetry.seconds());
+	else if (status==TaskStatus::timed_out) costs.record(description,options.timeout);
+}
+
+/** Study a Lie group in-process, reporting it to a progress monitor if present and recording the time taken in the cost model
+	@param G A Lie group
+	@param index The index of G, used to identify it in the progress monitor
+	@param description The Lie algebra, as given in the classification or in the input
+	@param cache A cache of results, or nullptr
+	@param options The command line options
+	@param progress A progress monitor, or nullptr
+	@param costs The cost model
+	@return The results, @sa study_group
+*/
+StudyRecord study_monitored(const LieGroup& G, int index, string_view description, const ResultCache* cache, const Options& options, Progress* progress, CostModel& costs) {
+	if (progress) progress->started(index);
+	StudyTelemetry telemetry;
+	try {
+		auto record=study_group(G,cache,options,&telemetry);
+		if (progress) {
+			progress->finished(index,TaskStatus::completed);
+			progress->add(index,telemetry);
+		}
+		record_time(description,TaskStatus::completed,telemetry,options,costs);
+		return record;
+	}
+	catch (...) {
+		if (progress) progress->finished(index,TaskStatus::failed);
+		throw;
+	}
+}
+
+/** Account for a Lie algebra studied in a worker process as soon as the worker terminates, reporting its telemetry to a progress monitor if present and recording the time taken in the cost model
+	@param index The index of the Lie algebra, used to identify it in the progress monitor
+	@param description The Lie algebra, as given in the classification or in the input
+	@param status The outcome of the study
+	@param output The output of the worker, as returned by study_in_worker
+	@param options The command line options
+	@param progress A progress monitor, or nullptr
+	@param costs The cost model
+*/
+void account(int index, string_view description, TaskStatus status, const string& output, const Options& options, Progress* progress, CostModel& costs) {
+	StudyTelemetry telemetry;
+	if (status==TaskStatus::completed) deserialize(output,&telemetry);
+	if (progress && status==TaskStatus::completed) progress->add(index,telemetry);
+	record_time(description,status,telemetry,options,costs);
+}
+
+/** Select the entries of a classification studied by a shard
+	@param classification A classification of Lie groups
+	@param selected The zero-based positions of the entries to consider, in increasing order
+	@param shard The shard
+	@return The positions in selected assigned to the shard, in increasing order, @sa shard_tasks
+
+	The costs are estimated from the descriptions of the entries, which are not constructed. Recorded times are not used, since they change as shards run, and a shard that is rerun or resumed must select the same entries, @sa CostModel.
+*/
+vector<int> shard_of_classification(const Classification<LieGroup>& classification, const vector<int>& selected, Shard shard) {
+	vector<double> costs;
+	for (int i: selected) costs.push_back(estimated_cost(classification.description(OneBased{i+1})));
+	vector<int> result;
+	for (int p: shard_tasks(costs,shard)) result.push_back(selected[p]);
 	return result;
 }
 
-/** Return an affine space N+W that is guaranteed to contain the Nikolayevsky derivation
-	@param G a Lie group of dimension n, with or without parameters
-	@param gl The Lie algebra of GL(n,R).
-	@return an AffineSpaceInGl object representing the affine space N+W
+/** Select the Lie algebras in a stream studied by a shard, reading the stream to the end
+	@param is A stream in the format accepted by next_lie_group_line
+	@param shard The shard
+	@return The zero-based positions of the Lie algebras assigned to the shard, in increasing order, @sa shard_tasks
+
+	As in shard_of_classification, the costs are estimated from the structure constants alone.
+*/
+vector<int> shard_of_stream(istream& is, Shard shard) {
+	vector<double> costs;
+	string line;
+	while (next_lie_group_line(is,line)) costs.push_back(estimated_cost(line));
+	return shard_tasks(costs,shard);
+}
+
+/** Study some entries of a classification, printing the results in the order of the classification
+	@param classification A classification of Lie groups
+	@param selected The zero-based positions of the entries to study, in increasing order
+	@param options The command line options controlling parallelism, resource limits, checkpointing and the output format
+	@param cache A cache of results, or nullptr
+	@param store A store where the results are appended, or nullptr
+	@param costs The cost model, where the time taken by each entry is recorded
 	
-	The computation is performed like in the case without parameters (@sa nikolayevsky_like_derivations), except that the space of derivations cannot be determined exactly, but only as a VectorSpaceBetween object. This implies that the resulting space N+W may contain elements that are not derivations, or do not satisfy tr(ND)=tr(D) for all derivations.
-*/
-AffineSpaceInGl nikolayevsky_like_derivations_parametric(const LieGroup& G, const GL& gl) {
-	auto derivations=derivations_parametric<StructureConstant>(G,gl);
-	VectorSpace<DifferentialForm> der{derivations.basis_of_larger_space};
-	auto eqns=nikolayevsky_equations(der.GenericElement(),derivations.basis_of_smaller_space,gl);
-	exvector solutions;
-	AffineSpaceInGl result;
-	der.GetSolutions(solutions,eqns.begin(),eqns.end(),&result.N);
-	result.W=VectorSpace<DifferentialForm>{solutions};
-	return result;
+	If options.deduplicate holds, entries that coincide up to relabeling with earlier entries whose study completed, or with Lie algebras in the store, are not studied, @sa print_duplicate. If options.isolate() holds, each entry is studied in a child process subject to the resource limits; entries that exceed them are reported and the run continues. Entries whose study throws an exception are reported as failed in either case. The entries expected to take longest are started first, @sa OrderedProcessPool::run_by_cost. Workers pass the whole record to the parent, which journals it in the checkpoint file as soon as the worker terminates, and prints it in the order of the classification. When resuming, entries journaled as completed are printed from the checkpoint file, and the others are studied again. Duplicates are neither journaled nor studied in a child process; if the study of the entry they coincide with does not complete, they are studied in a further round, and the output following them is held until then. If options.monitor() holds, the progress of the run is reported periodically, @sa Progress.
+*/
+void study_classification(const Classification<LieGroup>& classification, const vector<int>& selected, const Options& options, const ResultCache* cache, ResultStore* store, CostModel& costs) {
+	auto name=[&classification] (int index) {return classification.name(OneBased{index+1});};
+	auto description_of=[&classification] (int index) {return classification.description(OneBased{index+1});};
+	auto structure_constants=[&classification] (int index) {return horizontal(classification.entry(OneBased{index+1}).StructureConstants());};
+	optional<Deduplicator> known;
+	if (options.deduplicate) known=known_algebras(store);
+	optional<Progress> progress;
+	if (!options.isolate()) {
+		if (options.monitor()) progress.emplace(name,selected.size(),options.metrics,options.progress);
+		optional<ProgressTicker> ticker;
+		if (progress) ticker.emplace(*progress);
+		for (int i: selected) {
+			auto& G=classification.entry(OneBased{i+1});
+			if (auto duplicate=known? find_duplicate(*known,name(i),G) : nullopt) {
+				print_duplicate(name(i),structure_constants(i),*duplicate,options,store);
+				if (progress) progress->adjust_total(-1);
+				continue;
+			}
+			try {
+				auto record=study_monitored(G,i,description_of(i),cache,options,progress? &*progress : nullptr,costs);
+				print_record(name(i),record,options,store);
+				if (known) known->add(name(i),record.structure_constants);
+			}
+			catch (const exception& e) {
+				print_failure(name(i),structure_constants(i),i,string{"failed: "}+e.what(),options);
+			}
+		}
+		return;
+	}
+	optional<Checkpoint> checkpoint;
+	map<int,JournalEntry> processed;
+	if (!options.checkpoint.empty()) {
+		checkpoint.emplace(options.checkpoint,options.resume);
+		for (auto& entry: checkpoint->processed())		//entries that did not complete are retried, since the limits may have been raised or the failure may be transient
+			if (entry.second.status==TaskStatus::completed && binary_search(selected.begin(),selected.end(),entry.first)) processed.insert(entry);
+	}
+	map<int,Duplicate> duplicates;		//entries to be printed as duplicates
+	map<int,int> original;		//the entry each duplicate coincides with, unless it is a Lie algebra in the store
+	map<int,string> normal_forms;		//the structure constants of the duplicates, in normal form
+	map<string,int> index_of;		//the entries studied or printed from the checkpoint file, by name
+	vector<int> pending;
+	for (int i: selected) {
+		if (known) {
+			auto normal_form=StructureConstants{classification.entry(OneBased{i+1})}.normal_form();
+			auto outcome=known->add(name(i),normal_form);
+			if (outcome.duplicate && !processed.count(i)) {
+				duplicates.emplace(i,*outcome.duplicate);
+				if (auto j=index_of.find(outcome.duplicate->of);j!=index_of.end()) original[i]=j->second;
+				normal_forms[i]=normal_form;
+				continue;
+			}
+			if (!outcome.duplicate && outcome.same_invariants_as) cerr<<name(i)<<": same invariants as "<<*outcome.same_invariants_as<<", likely isomorphic"<<endl;
+			index_of[name(i)]=i;
+		}
+		if (!processed.count(i)) pending.push_back(i);
+	}
+	map<int,JournalEntry> studied;		//the entries studied in this run that have not been printed yet
+	set<int> failed;		//the entries studied in this run whose study did not complete
+	auto next_to_print=selected.begin();
+	auto print_ready=[&] () {		//print the entries in order, up to the first one whose outcome is not known yet
+		for (;next_to_print!=selected.end();++next_to_print) {
+			int i=*next_to_print;
+			if (auto entry=processed.find(i);entry!=processed.end()) print_record(name(i),deserialize(entry->second.output),options,store);
+			else if (auto duplicate=duplicates.find(i);duplicate!=duplicates.end()) {
+				auto j=original.find(i);
+				if (j!=original.end() && failed.count(j->second)) return;		//to be studied in a further round
+				print_duplicate(name(i),structure_constants(i),duplicate->second,options,store);
+			}
+			else if (auto entry=studied.find(i);entry!=studied.end()) {
+				if (entry->second.status==TaskStatus::completed) print_record(name(i),deserialize(entry->second.output),options,store);
+				else print_failure(name(i),structure_constants(i),i,description(entry->second.status,options),options);
+				studied.erase(entry);
+			}
+			else return;
+		}
+	};
+	OrderedProcessPool pool{options.jobs,ResourceLimits{options.timeout,options.memory}};
+	if (options.monitor()) {
+		progress.emplace(name,pending.size(),options.metrics,options.progress);
+		pool.set_monitor(&*progress,progress->report_interval());
+	}
+	while (!pending.empty()) {
+		set<int> dimensions;		//read from the descriptions, since constructing the entries is expensive
+		for (auto i: pending) dimensions.insert(described_dimension(description_of(i)));
+		for (int n: dimensions) prepare_dimension(n);	//constructed once and shared with the worker processes
+		vector<double> pending_costs;
+		for (int i: pending) pending_costs.push_back(costs.cost(description_of(i)));
+		pool.run_by_cost(pending,pending_costs,
+			[&classification,&options,cache] (int i) {
+				return study_in_worker(classification.entry(OneBased{i+1}),cache,options);
+			},
+			[&] (int index, TaskStatus status, const string& output) {
+				if (checkpoint) checkpoint->record(index,status,output);
+				account(index,description_of(index),status,output,options,progress? &*progress : nullptr,costs);
+			},
+			[&] (int index, TaskStatus status, const string& output) {
+				studied[index]=JournalEntry{status,output};
+				if (status!=TaskStatus::completed) failed.insert(index);
+				print_ready();
+			}
+		);
+		pending.clear();
+		Deduplicator orphans;		//the duplicates of entries whose study did not complete, among which the first of each class is studied in the next round
+		for (auto i=duplicates.begin();i!=duplicates.end();) {
+			auto j=original.find(i->first);
+			if (j==original.end() || !failed.count(j->second)) {++i; continue;}
+			int index=i->first;
+			auto outcome=orphans.add(name(index),normal_forms.at(index));
+			if (outcome.duplicate) {
+				i->second=*outcome.duplicate;
+				j->second=index_of.at(outcome.duplicate->of);
+				++i;
+			}
+			else {
+				index_of[name(index)]=index;
+				original.erase(j);
+				i=duplicates.erase(i);
+				pending.push_back(index);
+			}
+		}
+		if (progress) progress->adjust_total(pending.size());
+	}
+	print_ready();
 }
 
-/** Return the centralizer of an element N of gl inside a subspace of gl
-	@param N an element of gl
-	@param W a subspace of gl
-	@param gl The Lie algebra of GL(n,R)
-	@return The space of elements of W that commute with N
-*/
-
-auto centralizer(ex N, const VectorSpace<DifferentialForm>& W, const GL& gl) {
-	auto m=gl.glToMatrix(N);
-	auto w=gl.glToMatrix(W.GenericElement());
-	lst eqns;
-	auto commutator=gl.MatrixTo_gl(ex_to<matrix>((m*w-w*m).evalm()));
-	GetCoefficients<DifferentialForm>(eqns,commutator);
-	return W.SubspaceFromEquations(eqns.begin(),eqns.end());
-}
-
-/** Return the set of linear equations that a matrix should satisfy in order to define a derivation
-	@param G a Lie group of dimension n
-	@param gl The Lie algebra of GL(n,R)
-	@param matrix an element of gl
-	@result the equations that must be satisfied for the matrix to define a derivation of the Lie algebra of G
-*/	
-auto derivation_when(const LieGroup& G, const GL& gl, ex matrix) {
-	auto brackets=Xbrackets(G,GLRepresentation<VectorField>(&gl,G.e()),matrix);
-	set<ex,ex_is_less> eqns;
-	GetCoefficients<VectorField>(eqns,brackets);
-	eqns.erase(0);
-	return eqns;
-}
-
-
-void print_derivations(const LieGroup& G, const GL& gl) {
-	VectorSpace<DifferentialForm> der{derivations_parametric<StructureConstant>(G,gl).basis_of_larger_space};
-	auto gen_der=gl.glToMatrix(der.GenericElement());
-	cout<<dflt;
-	cout<<"generic derivation "<<gen_der<<endl;
-	cout<<"derivation when the following are zero: "<<derivation_when(G,gl,der.GenericElement())<<endl;	
-	cout<<latex;
-}
-
-class Nikolayevsky {
-	matrix N;
-	set<ex,ex_is_less> derivation_when;
-	bool is_diagonal() const {
-		for (int i=0;i<N.cols();++i)
-		for (int j=i+1;j<N.cols();++j)	
-			if (!N(i,j).is_zero() || !N(j,i).is_zero()) return false;
-		return true;	
-	}
-	exvector diagonal() const {
-			exvector diagonal;		
-			for (int i=0;i<N.cols();++i)
-				diagonal.push_back(N(i,i));
-			return diagonal;
-	}	
-public:
-	Nikolayevsky(const LieGroup& G, const GL& gl, ex nik) {
-		N=gl.glToMatrix(nik);
-		derivation_when=::derivation_when(G,gl,nik);	
-	}
-	string to_string() const {
-			stringstream result;
-			if (!derivation_when.empty()) 
-				result<<"cannot compute; Nikolayevsky derivation takes the form "<<N<<", only derivation when the following are zero: "<<derivation_when;			
-			else if (is_diagonal()) 
-				result<<horizontal(diagonal());
-			else 
-				result<<"if diagonalizable, "<<N;				
-			return result.str() ;
-	}
-	bool computed() const {
-		return derivation_when.empty() && is_diagonal();
-	}
-};
-
-
-void study_group(const LieGroup& G) {
-	cout<<latex<<endl;
-	GL gl(G.Dimension());
-	auto nik_like_derivations=nikolayevsky_like_derivations_parametric(G,gl);
-	cout<<"Lie algebra:"<<horizontal(G.StructureConstants())<<endl;
-	auto nik=Nikolayevsky(G,gl,nik_like_derivations.N);
-	cout<<"Nikolayevsky derivation: "<<nik.to_string()<<endl;	
-	auto centralizer_of_nik=centralizer(nik_like_derivations.N,nik_like_derivations.W,gl);	//compute a space which contains the centralizer of the Nikolayevsky derivation inside the null space of the trace form
-	print_derivations(G,gl);
-	if (nik_like_derivations.N.is_zero()) {cout<<"Nikolayevsky derivation is zero"<<endl; return;}	
-	if (nik.computed() && !centralizer_of_nik.Dimension()) 
-	{
-		cout<<"trivial centralizer"<<endl; 
+/** Study the Lie groups read from a stream, one per line, printing the results in the order of the input
+	@param is A stream in the format accepted by next_lie_group_line and lie_group_from_string
+	@param selected The zero-based positions of the Lie algebras to study, in increasing order, or nullptr to study all of them
+	@param options The command line options controlling parallelism, resource limits and the output format
+	@param cache A cache of results, or nullptr
+	@param store A store where the results are appended, or nullptr
+	@param costs The cost model, where the time taken by each Lie algebra is recorded
+
+	Each Lie algebra is named after its position in the input, starting from 1, whether it is selected or not; its results are stored under the normal form of its structure constants, so that the records of different inputs do not replace each other. If options.isolate() holds, each line is parsed and studied in a child process, while the parent reads further lines and prints the results; only a bounded number of lines is held in memory, @sa OrderedProcessPool::run_stream. Lines that cannot be parsed or studied are reported, and the run continues. If options.deduplicate holds, Lie algebras that coincide up to relabeling with Lie algebras in the store, or with earlier ones whose results have been printed when they are read, are not studied, @sa print_duplicate; in parallel runs, a Lie algebra read while an isomorphic one is still being studied is studied again. If options.monitor() holds, the progress of the run is reported periodically, @sa Progress; the number of Lie algebras to study is only known in advance if they are selected.
+*/
+void study_stream(istream& is, const vector<int>* selected, const Options& options, const ResultCache* cache, ResultStore* store, CostModel& costs) {
+	string line;
+	int position=-1;
+	auto next_selected_line=[&] () {
+		while (next_lie_group_line(is,line))
+			if (++position, !selected || binary_search(selected->begin(),selected->end(),position)) return true;
+		return false;
+	};
+	optional<Deduplicator> known;
+	if (options.deduplicate) known=known_algebras(store);
+	optional<Progress> progress;
+	if (options.monitor()) progress.emplace([] (int index) {return std::to_string(index+1);},selected? optional<int>{static_cast<int>(selected->size())} : nullopt,options.metrics,options.progress);
+	if (!options.isolate()) {
+		optional<ProgressTicker> ticker;
+		if (progress) ticker.emplace(*progress);
+		while (next_selected_line()) {
+			int i=position;
+			auto name=std::to_string(i+1);
+			try {
+				auto G=lie_group_from_string(line);
+				if (auto duplicate=known? find_duplicate(*known,name,*G) : nullopt) {
+					print_duplicate(name,line,*duplicate,options,store,true);
+					if (progress) progress->adjust_total(-1);
+					continue;
+				}
+				auto record=study_monitored(*G,i,line,cache,options,progress? &*progress : nullptr,costs);
+				print_record(name,record,options,store,true);
+				if (known) known->add(name,record.structure_constants);
+			}
+			catch (const exception& e) {
+				print_failure(name,line,i,string{"failed: "}+e.what(),options);
+			}
+		}
 		return;
 	}
-	cout<<"Centralizer contained in space of dimension "<<centralizer_of_nik.Dimension()<<endl;
-	auto generic_element=gl.glToMatrix(centralizer_of_nik.GenericElement());
-	cout<<"generic element "<<generic_element<<endl;
-	auto conditions_for_element_of_centralizer_to_be_a_derivation=derivation_when(G,gl,centralizer_of_nik.GenericElement());
-	if (!conditions_for_element_of_centralizer_to_be_a_derivation.empty())
-		cout<<"derivation when the following are zero: "<<conditions_for_element_of_centralizer_to_be_a_derivation<<endl;
+	map<int,string> lines;
+	map<int,Duplicate> duplicates;		//the duplicates among the Lie algebras read and not printed yet
+	OrderedProcessPool pool{options.jobs,ResourceLimits{options.timeout,options.memory}};
+	if (progress) pool.set_monitor(&*progress,progress->report_interval());
+	pool.run_stream(
+		[&] () -> optional<int> {
+			if (!next_selected_line()) return nullopt;
+			optional<Duplicate> duplicate;
+			if (known)
+				try {duplicate=find_duplicate(*known,std::to_string(position+1),*lie_group_from_string(line));}
+				catch (const exception&) {}		//the error is reported by the worker
+			if (duplicate) {
+				duplicates.emplace(position,*duplicate);
+				if (progress) progress->adjust_total(-1);
+			}
+			else prepare_dimension(described_dimension(line));	//constructed once and shared with the worker processes
+			lines[position]=line;
+			return position;
+		},
+		[&duplicates] (int i) {return duplicates.count(i)>0;},		//printed by the parent
+		[&lines,&options,cache] (int i) {
+			return study_in_worker(*lie_group_from_string(lines.at(i)),cache,options);
+		},
+		[&lines,&options,store,&progress,&costs,&duplicates,&known] (int index, TaskStatus status, const string& output) {
+			auto name=std::to_string(index+1);
+			if (auto duplicate=duplicates.find(index);duplicate!=duplicates.end()) {
+				print_duplicate(name,lines.at(index),duplicate->second,options,store,true);
+				duplicates.erase(duplicate);
+			}
+			else {
+				account(index,lines.at(index),status,output,options,progress? &*progress : nullptr,costs);
+				if (status==TaskStatus::completed) {
+					auto record=deserialize(output);
+					print_record(name,record,options,store,true);
+					if (known) known->add(name,record.structure_constants);
+				}
+				else print_failure(name,lines.at(index),index,description(status,options),options);
+			}
+			lines.erase(index);
+		}
+	);
 }
 
+/** Answer requests on a Unix socket until the program is interrupted, @sa Server
+	@param options The command line options; options.serve is the socket, options.jobs the number of worker processes, and options.timeout and options.memory apply to each request
+	@param cache A cache of results, or nullptr
+	@param store A store where the results are appended, or nullptr
 
-int main(int argv, char** argc) {
-	if (argv==2) study_group(AbstractLieGroup<false>(argc[1]));
-	else for (auto& G : NilpotentLieGroups7()) 
-		study_group(*G);	
+	Each request is a Lie algebra in the format accepted by lie_group_from_string, and is answered by a JSON object as in --format json, named after the request. Answers are kept in memory up to options.answer_cache megabytes, so that repeated requests are answered without forking a worker, @sa AnswerCache.
+*/
+void serve(const Options& options, const ResultCache* cache, ResultStore* store) {
+	AnswerCache answers{static_cast<size_t>(options.answer_cache)*1024*1024};
+	Server server{options.serve,options.jobs,ResourceLimits{options.timeout,options.memory},
+		[&answers] (const string& line) {
+			return answers.find(line);
+		},
+		[] (const string& line) {
+			prepare_dimension(described_dimension(line));	//constructed once and shared with the worker processes
+		},
+		[&options,cache] (const string& line) {
+			return serialize(study_group(*lie_group_from_string(line),cache,options));
+		},
+		[&answers,&options,store] (const string& line, TaskStatus status, const string& output) {
+			stringstream answer;
+			auto reason=description(status,options);
+			if (status==TaskStatus::completed)
+				try {
+					auto record=deserialize(output);
+					write_json(answer,line,record);
+					if (store) store->append(line,record);
+					answers.insert(line,answer.str());
+					return answer.str();
+				}
+				catch (const runtime_error& e) {
+					reason=string{"failed: "}+e.what();
+				}
+			else if (status==TaskStatus::failed && !output.empty()) reason="failed: "+output;		//the message of the exception thrown by the worker
+			write_json_failure(answer,line,reason);
+			return answer.str();
+		}
+	};
+	server.run();
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	optional<ResultCache> cache;
+	optional<ResultStore> store;
+	CostModel costs;
+	try {
+		options=parse_options(argc,argv);
+		if (!options.cache.empty()) cache.emplace(options.cache);
+		if (!options.store.empty()) store.emplace(options.store);
+		if (!options.timings.empty()) costs=CostModel{options.timings};
+	}
+	catch (const invalid_argument& e) {
+		cerr<<e.what()<<endl<<usage();
+		return 1;
+	}
+	catch (const runtime_error& e) {
+		cerr<<e.what()<<endl;
+		return 1;
+	}
+	if (!options.serve.empty())
+		try {
+			serve(options,cache? &*cache : nullptr,store? &*store : nullptr);
+			return 0;
+		}
+		catch (const runtime_error& e) {
+			cerr<<e.what()<<endl;
+			return 1;
+		}
+	ifstream input_file;
+	istream* input=&cin;
+	if (!options.input.empty() && options.input!="-") {
+		input_file.open(options.input);
+		if (!input_file) {
+			cerr<<"cannot open "<<options.input<<endl;
+			return 1;
+		}
+		input=&input_file;
+	}
+	unique_ptr<Classification<LieGroup>> classification;
+	vector<int> selected;
+	if (options.input.empty() && options.algebras.empty())
+		try {
+			if (options.classification.empty()) classification=make_unique<NilpotentLieGroups7>();
+			else classification=make_unique<ClassificationFile>(options.classification);
+			if (options.only.empty())
+				for (int i=0;i<classification->size();++i) selected.push_back(i);
+			else selected=select_entries(*classification,options.only);
+			if (options.shard.count>1) selected=shard_of_classification(*classification,selected,options.shard);
+		}
+		catch (const exception& e) {
+			cerr<<e.what()<<endl;
+			return 1;
+		}
+	optional<vector<int>> selected_lines;
+	if (!options.input.empty() && options.shard.count>1) {
+		selected_lines=shard_of_stream(*input,options.shard);
+		input->clear();
+		input->seekg(0);
+	}
+	const vector<int>* selected_lines_ptr=selected_lines? &*selected_lines : nullptr;
+	if (options.screen || options.fingerprint) {
+		optional<Deduplicator> known;
+		if (options.fingerprint) known=known_algebras(store? &*store : nullptr);
+		auto screen=[&known] (const LieGroup& G, const string& name) {
+			if (known) fingerprint_group(G,name,*known);
+			else screen_group(G,name);
+		};
+		string line;
+		if (!options.input.empty()) {
+			int position=-1;
+			while (next_lie_group_line(*input,line)) 
+				if (++position, !selected_lines || binary_search(selected_lines->begin(),selected_lines->end(),position))
+					try {screen(*lie_group_from_string(line),line);}
+					catch (const exception& e) {cout<<"failed: "<<e.what()<<endl;}
+		}
+		else if (!options.algebras.empty())
+			for (auto& structure_constants : options.algebras)
+				screen(AbstractLieGroup<false>(structure_constants.c_str()),structure_constants);
+		else 
+			for (int i: selected)
+				screen(classification->entry(OneBased{i+1}),classification->name(OneBased{i+1}));
+		return 0;
+	}
+	const ResultCache* cache_ptr=cache? &*cache : nullptr;
+	ResultStore* store_ptr=store? &*store : nullptr;
+	if (!options.algebras.empty()) 
+		for (auto& structure_constants : options.algebras)
+			print_record(structure_constants,study_group(AbstractLieGroup<false>(structure_constants.c_str()),cache_ptr,options),options,store_ptr);
+	else try {
+		if (!options.input.empty()) study_stream(*input,selected_lines_ptr,options,cache_ptr,store_ptr,costs);
+		else study_classification(*classification,selected,options,cache_ptr,store_ptr,costs);
+	}
+	catch (const runtime_error& e) {
+		cout<<flush;
+		cerr<<e.what()<<endl;
+		return 1;
+	}
+	cout<<flush;
 }
@@ -0,0 +1,103 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GLEIPNIR_H
+#define GLEIPNIR_H
+
+/* The interface of the gleipnir library, which studies the Nikolayevsky derivation of a Lie algebra in-process
+
+	Only this header should be included by programs linking the library; the other headers contain definitions and may be included by a single translation unit. No function in the library writes on standard output.
+*/
+
+#include <wedge/wedge.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <optional>
+#include "telemetry.h"
+
+/** The options of the study of a Lie algebra */
+struct StudyOptions {
+	int threads=1;				///< the number of threads used to solve independent blocks of the equations for the derivations
+	int specialize=0;			///< if positive and the Lie algebra depends on parameters, the number of threads used to compute the Nikolayevsky derivation by specializing the parameter
+};
+
+/** The Nikolayevsky derivation of a Lie algebra depending on one parameter, computed by specialization for generic values of the parameter */
+struct GenericNikolayevskyResult {
+	bool computed=false;						///< false if the derivation could not be reconstructed from the specializations; the other fields are then not set
+	GiNaC::ex parameter;
+	GiNaC::matrix N;
+	GiNaC::ex denominator;					///< a polynomial in the parameter that vanishes at all values where N may not be valid
+	int dimension_of_derivations=0;	///< dim Der for generic values of the parameter
+	GiNaC::exvector exceptional;		///< the rational values of the parameter where dim Der differs from the generic one
+	GiNaC::ex possibly_exceptional=1;	///< a polynomial in the parameter whose roots, if irrational, may be further values where dim Der is not generic; 1 if there are none
+};
+
+/** The results of the study of a Lie algebra; matrices act on the Lie algebra, in the basis in which the structure constants are given */
+struct StudyResult {
+	GiNaC::matrix generic_derivation;								///< the generic element of a space containing the derivations
+	std::set<GiNaC::ex,GiNaC::ex_is_less> derivation_when;		///< the conditions on the generic derivation to be a derivation, which only arise in the presence of parameters
+	std::vector<GiNaC::matrix> derivation_basis;		///< a basis D_1,...,D_m of the space of derivations
+	GiNaC::matrix trace_form;												///< the matrix of the trace form tr(E_jD_i), where E_1,...,E_k is a basis of the derivations that are such for all values of the parameters
+	GiNaC::matrix nikolayevsky;											///< the candidate N satisfying tr(ND)=tr(D) for all derivations D
+	std::set<GiNaC::ex,GiNaC::ex_is_less> nikolayevsky_when;	///< the conditions for N to be a derivation
+	bool nikolayevsky_computed=false;								///< true if N is a derivation and is diagonalizable, so that it is the Nikolayevsky derivation
+	GiNaC::exvector eigenvalues;										///< the eigenvalues of N with repetitions, if nikolayevsky_computed holds
+	std::string nikolayevsky_description;						///< a description of N and of its eigenvalues
+	std::optional<GenericNikolayevskyResult> generic_nikolayevsky;	///< set if specialization was requested and the Lie algebra depends on parameters
+	std::vector<GiNaC::matrix> null_space;					///< a basis of the space W of derivations X with tr(XD)=0 for all derivations D
+	std::vector<GiNaC::matrix> centralizer;					///< a basis of a space containing the centralizer of N in W
+	GiNaC::matrix generic_centralizer_element;			///< the generic element of the space spanned by centralizer
+	std::optional<std::set<GiNaC::ex,GiNaC::ex_is_less>> centralizer_derivation_when;	///< the conditions for the generic element of centralizer to be a derivation; only computed if N is nonzero and the centralizer is not known to be trivial
+	StudyTelemetry telemetry;								///< the time spent in each stage, the peak memory usage and the size of the results
+/** Return true if the candidate N is zero */
+	bool nikolayevsky_is_zero() const {
+		for (int i=0;i<nikolayevsky.rows();++i)
+		for (int j=0;j<nikolayevsky.cols();++j)
+			if (!nikolayevsky(i,j).is_zero()) return false;
+		return true;
+	}
+};
+
+/** Study a Lie algebra
+	@param G A Lie group
+	@param options The options of the study
+	@return The results
+*/
+StudyResult study(const Wedge::LieGroup& G, const StudyOptions& options={});
+
+/** Study a Lie algebra given by its structure constants
+	@param lie_algebra The structure constants, optionally followed by a semicolon and the names of the parameters, as in "0,0,12,13,[lambda]*14+23; lambda"
+	@param options The options of the study
+	@return The results
+	@exception std::invalid_argument if lie_algebra has more than three parameters
+*/
+StudyResult study(const std::string& lie_algebra, const StudyOptions& options={});
+
+/** Compute the dimension of the derivation algebra of a Lie group modulo primes, without any symbolic computation
+	@param G A Lie group
+	@return The dimension, or nothing if G depends on parameters
+*/
+std::optional<int> derivation_dimension_modulo_primes(const Wedge::LieGroup& G);
+
+/** Construct the objects shared by the study of all Lie algebras of a given dimension, so that processes forked afterwards inherit them
+	@param n The dimension
+*/
+void prepare_dimension(int n);
+
+#endif
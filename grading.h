@@ -0,0 +1,142 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GRADING_H
+#define GRADING_H
+
+#include <vector>
+#include <map>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include "sparselinear.h"
+#include "modular.h"
+#include "structureconstants.h"
+
+/** Return the equations that define the diagonal derivations of a Lie algebra
+	@param c The structure constants of a Lie algebra, with or without parameters
+	@return The equations d_k-d_i-d_j=0 in the unknowns d_1,...,d_n for all i<j,k such that c_ij^k is nonzero
+
+	A diagonal matrix diag(d_1,...,d_n) is a derivation if and only if these equations hold. For a Lie algebra with parameters, the structure constants that depend on the parameters are considered nonzero, so that the solutions are derivations for all values of the parameters.
+*/
+IntegerEquations diagonal_derivation_equations(const StructureConstants& c) {
+	int n=c.dimension();
+	IntegerEquations equations{n,{}};
+	for (auto ij: c.nonzero_brackets())
+		for (auto& x: c.bracket(ij.first,ij.second)) {
+			RationalRow row;
+			row[ij.first]-=1;
+			row[ij.second]-=1;
+			row[x.k]+=1;
+			auto integer_row=to_integer_row(row);
+			if (!integer_row.empty()) equations.rows.push_back(move(integer_row));
+		}
+	return equations;
+}
+
+/** Partition the coordinates of gl according to the weights of the torus of diagonal derivations
+	@param c The structure constants of a Lie algebra of dimension n
+	@param action A vector of size n^2, whose entry l*n+i is the coefficient of e_l in Ae_i, as a linear function of the coordinates of gl
+	@param columns The number of coordinates of gl
+	@return A partition of the coordinates such that the equations for an element of gl to be a derivation only relate coordinates in the same block
+
+	If D is a diagonal derivation, the matrix E_li which maps e_i to e_l is an eigenvector of ad_D with eigenvalue d_l-d_i. Since the equations [Ae_i,e_j]+[e_i,Ae_j]-A[e_i,e_j]=0 are invariant under the torus of diagonal derivations, each of them only involves the entries of A in a single weight space. Coordinates that appear in entries of different weights are placed in the same block.
+*/
+Blocks weight_blocks(const StructureConstants& c, const vector<RationalRow>& action, int columns) {
+	int n=c.dimension();
+	auto torus=rational_kernel(diagonal_derivation_equations(c));
+	map<vector<mpq_class>,int> column_of_weight;		//a column appearing in an entry of each weight
+	Blocks blocks{columns};
+	for (int l=0;l<n;++l)
+	for (int i=0;i<n;++i) {
+		auto& linear_form=action[l*n+i];
+		if (linear_form.empty()) continue;
+		int column=linear_form.begin()->first;
+		for (auto& entry: linear_form) blocks.merge(entry.first,column);
+		vector<mpq_class> weight;
+		for (auto& D: torus) {
+			auto d_l=D.find(l), d_i=D.find(i);
+			weight.push_back((d_l==D.end()? 0 : d_l->second)-(d_i==D.end()? 0 : d_i->second));
+		}
+		blocks.merge(column,column_of_weight.emplace(move(weight),column).first->second);
+	}
+	return blocks;
+}
+
+/** Compute a basis of the space of solutions of a system of integer equations, solving independent blocks separately
+	@param equations A list of equations with integer coefficients
+	@param blocks A partition of the columns, such that the equations only relate columns in the same block; blocks are merged if an equation does not respect this
+	@param threads The number of threads used to solve the blocks
+	@return The same basis as rational_kernel(equations)
+
+	The kernel vector corresponding to a free column f has entries at f and at pivot columns preceding f, so that the kernels of the blocks can be merged by sorting on the last nonzero entry.
+*/
+vector<RationalRow> block_kernel(const IntegerEquations& equations, Blocks blocks, int threads=1) {
+	for (auto& row: equations.rows)
+		for (auto& entry: row) blocks.merge(entry.first,row.front().first);
+	map<int,int> index_of_block;
+	vector<IntegerEquations> systems;
+	vector<vector<int>> columns_of_block;
+	vector<int> local_column(equations.columns);
+	for (int column=0;column<equations.columns;++column) {
+		auto i=index_of_block.emplace(blocks.block(column),systems.size()).first->second;
+		if (i==systems.size()) {
+			systems.push_back(IntegerEquations{0,{}});
+			columns_of_block.emplace_back();
+		}
+		local_column[column]=systems[i].columns++;
+		columns_of_block[i].push_back(column);
+	}
+	for (auto& row: equations.rows) {
+		auto& system=systems[index_of_block[blocks.block(row.front().first)]];
+		IntegerRow local_row;
+		for (auto& entry: row) local_row.emplace_back(local_column[entry.first],entry.second);
+		system.rows.push_back(move(local_row));
+	}
+	vector<int> order(systems.size());		//largest systems first, so that threads finish at about the same time
+	iota(order.begin(),order.end(),0);
+	sort(order.begin(),order.end(),[&systems] (int i, int j) {return systems[i].rows.size()>systems[j].rows.size();});
+	vector<vector<RationalRow>> kernels(systems.size());
+	atomic<int> next{0};
+	auto worker=[&] () {
+		for (int i;(i=next++)<order.size();) {
+			auto& system=systems[order[i]];
+			if (!system.rows.empty()) kernels[order[i]]=rational_kernel(system);
+			else for (int column=0;column<system.columns;++column) {
+				RationalRow unit;
+				unit[column]=1;
+				kernels[order[i]].push_back(move(unit));
+			}
+		}
+	};
+	vector<thread> pool;
+	for (int i=1;i<threads && i<systems.size();++i) pool.emplace_back(worker);
+	worker();
+	for (auto& t: pool) t.join();
+	vector<RationalRow> result;
+	for (int i=0;i<systems.size();++i)
+		for (auto& local_solution: kernels[i]) {
+			RationalRow solution;
+			for (auto& entry: local_solution) solution[columns_of_block[i][entry.first]]=entry.second;
+			result.push_back(move(solution));
+		}
+	sort(result.begin(),result.end(),[] (const RationalRow& x, const RationalRow& y) {return x.rbegin()->first<y.rbegin()->first;});
+	return result;
+}
+
+#endif
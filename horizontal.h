@@ -40,6 +40,13 @@ template<typename Vector> string horizontal(const Vector& v, string sep=",") {
 	return ss.str();
 }
 
+/** Return a string representation of an object in the default GiNaC format */
+template<typename T> string to_string_dflt(const T& x) {
+	stringstream s;
+	s<<dflt<<x;
+	return s.str();
+}
+
 inline string to_string(const exvector& v) {
   return "("+horizontal(v)+")\n";
 }
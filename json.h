@@ -0,0 +1,114 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <optional>
+#include <vector>
+#include "record.h"
+
+/** Return a string as a JSON string literal */
+inline std::string json_string(const std::string& s) {
+	std::string result="\"";
+	for (unsigned char c: s)
+		if (c=='"' || c=='\\') result+=std::string{'\\',static_cast<char>(c)};
+		else if (c=='\n') result+="\\n";
+		else if (c<0x20) {
+			char escaped[7];
+			std::snprintf(escaped,sizeof(escaped),"\\u%04x",c);
+			result+=escaped;
+		}
+		else result+=c;
+	return result+"\"";
+}
+
+/** Return the name of the Lie algebra in a line written by write_json or write_json_failure
+	@param line A line of JSON Lines output
+	@return The unescaped value of the name field, which comes first, or nothing if the line does not start with a name field
+*/
+inline std::optional<std::string> json_name(const std::string& line) {
+	const std::string prefix="{\"name\":\"";
+	if (line.compare(0,prefix.size(),prefix)!=0) return std::nullopt;
+	std::string result;
+	for (auto i=prefix.size();i<line.size();++i) {
+		if (line[i]=='"') return result;
+		if (line[i]!='\\') {result+=line[i]; continue;}
+		if (++i==line.size()) break;
+		if (line[i]=='n') result+='\n';
+		else if (line[i]=='u' && i+4<line.size()) {
+			result+=static_cast<char>(std::stoi(line.substr(i+1,4),nullptr,16));
+			i+=4;
+		}
+		else result+=line[i];
+	}
+	return std::nullopt;
+}
+
+/** Return a string containing one item per line as a JSON array of strings */
+inline std::string json_array(const std::string& lines) {
+	std::stringstream s{lines};
+	std::string result="[", line;
+	while (getline(s,line))
+		result+=(result.size()>1? ",":"")+json_string(line);
+	return result+"]";
+}
+
+/** Write a record as a single line of JSON, without flushing
+	@param os The stream
+	@param name The name of the Lie algebra
+	@param record The results; the textual output is omitted
+*/
+inline void write_json(std::ostream& os, const std::string& name, const StudyRecord& record) {
+	os<<"{\"name\":"<<json_string(name)
+		<<",\"status\":\"completed\""
+		<<",\"structure_constants\":"<<json_string(record.structure_constants)
+		<<",\"derivations\":"<<json_string(record.derivations)
+		<<",\"derivation_basis\":"<<json_array(record.derivation_basis)
+		<<",\"nikolayevsky\":"<<json_string(record.nikolayevsky)
+		<<",\"eigenvalues\":"<<json_array(record.eigenvalues)
+		<<",\"derivation_when\":"<<json_string(record.derivation_when)
+		<<",\"trace_form\":"<<json_string(record.trace_form)
+		<<",\"centralizer_dimension\":"<<(record.centralizer_dimension.empty()? std::string{"null"} : record.centralizer_dimension)
+		<<",\"centralizer\":"<<json_string(record.centralizer)
+		<<"}\n";
+}
+
+/** Write an entry that coincides with a Lie algebra seen before as a single line of JSON, without flushing, @sa Duplicate
+	@param os The stream
+	@param name The name of the Lie algebra
+	@param of The name of the Lie algebra seen before
+	@param relabeling The one-based index of the element of the basis of the other Lie algebra corresponding to each e_i, or an empty vector if the structure constants are identical
+*/
+inline void write_json_duplicate(std::ostream& os, const std::string& name, const std::string& of, const std::vector<int>& relabeling) {
+	os<<"{\"name\":"<<json_string(name)<<",\"duplicate_of\":"<<json_string(of)<<",\"relabeling\":";
+	if (relabeling.empty()) os<<"null";
+	else for (int i=0;i<relabeling.size();++i) os<<(i? ',' : '[')<<relabeling[i];
+	os<<(relabeling.empty()? "" : "]")<<"}\n";
+}
+
+/** Write the outcome of an entry that could not be studied as a single line of JSON, without flushing */
+inline void write_json_failure(std::ostream& os, const std::string& name, const std::string& status) {
+	os<<"{\"name\":"<<json_string(name)<<",\"status\":"<<json_string(status)<<"}\n";
+}
+
+#endif
@@ -19,18 +19,101 @@
 #define LINEARSOLVE_H
 
 #include <wedge/wedge.h>
+#include <set>
+#include "polynomiallinear.h"
+#include "sparselinear.h"
 
-namespace Wedge {
-namespace linear_impl {
+/** Normalize a list of linear equations
+	@param equations A list of equations, or of expressions to be equated to zero
+	@return The expressions lhs-rhs, expanded, divided by the integer content of their coefficients and with a canonical sign, without repetitions and without those that vanish identically
+*/
+inline GiNaC::exvector normalize_linear_equations(const GiNaC::lst& equations) {
+	std::set<GiNaC::ex,GiNaC::ex_is_less> normalized;
+	for (auto eq: equations) {
+		GiNaC::ex e=(GiNaC::is_a<GiNaC::relational>(eq)? eq.lhs()-eq.rhs() : eq).expand();
+		if (e.is_zero()) continue;
+		e=(e/e.integer_content()).expand();
+		GiNaC::ex opposite=(-e).expand();
+		normalized.insert(GiNaC::ex_is_less{}(opposite,e)? opposite : e);
+	}
+	return {normalized.begin(),normalized.end()};
+}
 
-template<typename IsAdmissibleSolution>
-lst solve_linear(const lst& eqns, const lst& unknowns,const IsAdmissibleSolution& isAdmissibleSolution) {
-	ex sol=DefaultLinAlgAlgorithms::lsolve(eqns,unknowns);
-	if (sol==lst() || !isAdmissibleSolution(sol)) return {};
-	assert(is_a<lst>(sol));
-	return ex_to<lst>(sol);
+/** A set of equations, together with the unknowns that appear in them */
+struct LinearComponent {
+	GiNaC::lst equations;
+	GiNaC::lst unknowns;
+};
+
+/** Split a linear system into the connected components of the graph where an equation is joined to the unknowns that appear in it
+	@param equations A list of expressions to be equated to zero, as returned by normalize_linear_equations
+	@param unknowns A list of symbols
+	@return The components that contain at least one equation, in the order of their first unknown; equations containing no unknowns form a component with no unknowns, which comes last
+
+	The components are independent systems, so that the solutions of the system are obtained by solving each component separately; unknowns that do not appear in any equation are free.
+*/
+inline std::vector<LinearComponent> connected_components(const GiNaC::exvector& equations, const GiNaC::lst& unknowns) {
+	std::map<GiNaC::ex,int,GiNaC::ex_is_less> index;
+	GiNaC::exvector x{unknowns.begin(),unknowns.end()};
+	for (int i=0;i<x.size();++i) index.emplace(x[i],i);
+	Blocks blocks{int(x.size())};
+	std::vector<int> unknown_of_equation;		//an unknown appearing in each equation, or -1
+	for (auto& eq: equations) {
+		int first=-1;
+		for (auto i=eq.preorder_begin();i!=eq.preorder_end();++i) {
+			auto j=index.find(*i);
+			if (j==index.end()) continue;
+			if (first<0) first=j->second;
+			else blocks.merge(j->second,first);
+		}
+		unknown_of_equation.push_back(first);
+	}
+	std::map<int,int> component_of_block;
+	std::vector<LinearComponent> result;
+	for (int i=0;i<equations.size();++i) {
+		if (unknown_of_equation[i]<0) continue;
+		auto component=component_of_block.emplace(blocks.block(unknown_of_equation[i]),result.size()).first->second;
+		if (component==result.size()) result.emplace_back();
+		result[component].equations.append(equations[i]);
+	}
+	for (int i=0;i<x.size();++i) {
+		auto component=component_of_block.find(blocks.block(i));
+		if (component!=component_of_block.end()) result[component->second].unknowns.append(x[i]);
+	}
+	std::sort(result.begin(),result.end(),[&index] (const LinearComponent& a, const LinearComponent& b) {return index[a.unknowns.op(0)]<index[b.unknowns.op(0)];});
+	LinearComponent constants;
+	for (int i=0;i<equations.size();++i) 
+		if (unknown_of_equation[i]<0) constants.equations.append(equations[i]);
+	if (constants.equations.nops()) result.push_back(constants);
+	return result;
+}
+
+/** Solve a linear system by normalizing the equations and solving each connected component separately with fraction_free_lsolve; this is a replacement for lsolve
+	@param equations A list of equations, or of expressions to be equated to zero, which are affine in the unknowns
+	@param unknowns A list of symbols
+	@return An empty list if the system has no solution, otherwise a list of relations x==value, one for each unknown in the given order, where value is x itself if x is free
+
+	GiNaC is not thread-safe, so the components are solved one after the other; the gain comes from eliminating in many small systems rather than one large one.
+*/
+inline GiNaC::lst solve_by_components(const GiNaC::lst& equations, const GiNaC::lst& unknowns) {
+	GiNaC::exmap values;
+	for (auto& component: connected_components(normalize_linear_equations(equations),unknowns)) {
+		if (component.unknowns.nops()==0) return {};		//nonzero equations in no unknowns
+		auto solution=fraction_free_lsolve(component.equations,component.unknowns);
+		if (solution==GiNaC::lst{}) return {};
+		for (auto x: solution) values[x.lhs()]=x.rhs();
+	}
+	GiNaC::lst result;
+	for (auto x: unknowns) {
+		auto i=values.find(x);
+		result.append(x==(i==values.end()? x : i->second));
+	}
+	return result;
 }
 
+namespace Wedge {
+namespace linear_impl {
+
 inline bool is_trivial_solution(const lst& sol) {
 	return all_of(sol.begin(),sol.end(),[](ex eq) {return eq.rhs()==eq.lhs();});
 }
@@ -47,10 +130,18 @@ template<class Variable>
 class AbstractPolynomialEquations {
   void update_solution(lst solution) {
     if (solution==lst{}) sol.remove_all();
+    exmap substitution;
+    for (auto x: solution) 
+      if (x.lhs()!=x.rhs()) substitution[x.lhs()]=x.rhs();
     for (int i=0;i<sol.nops();++i)
-			sol.let_op(i)=sol.op(i).lhs()==sol.op(i).rhs().subs(solution);
-    for (int i=0;i<equations.nops();++i)
-			equations.let_op(i)=equations.op(i).subs(sol).expand();
+			sol.let_op(i)=sol.op(i).lhs()==sol.op(i).rhs().subs(substitution);
+    lst remaining;		//equations that vanish identically are dropped
+    for (auto eq: equations) {
+      ex substituted=eq.subs(substitution);
+      if (!are_ex_trivially_equal(substituted,eq)) substituted=substituted.expand();
+      if (!substituted.is_zero()) remaining.append(substituted);
+    }
+    equations=std::move(remaining);
   }
   static lst expand(const lst& eqns) {
     lst result;
@@ -59,8 +150,11 @@ class AbstractPolynomialEquations {
   }
   static lst expand(lst&& eqns) {
   	ex subs = abs(-wild()) == abs(wild());
-    for (int i=0;i<eqns.nops();++i)
-      eqns.let_op(i)=eqns.op(i).expand().subs(subs).expand();
+    for (int i=0;i<eqns.nops();++i) {
+      ex eq=eqns.op(i).expand();
+      if (eq.has(abs(wild()))) eq=eq.subs(subs).expand();
+      eqns.let_op(i)=eq;
+    }
     return std::move(eqns);
   }
 protected:
@@ -86,7 +180,7 @@ public:
   bool eliminate_linear_equations() {
 		lst linear=linear_equations();
 		if (linear==lst{}) return false;
-    update_solution(DefaultLinAlgAlgorithms::lsolve(linear,variables));
+    update_solution(solve_by_components(linear,variables));
     return true;
   }
   lst solution() const {return sol;}
@@ -0,0 +1,148 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include "classification.h"
+#include "horizontal.h"
+#include "json.h"
+#include "options.h"
+
+/** The command line options of gleipnir_merge */
+struct MergeOptions {
+	string classification;			///< data file containing the classification, @sa ClassificationFile; if empty, the classification of seven-dimensional nilpotent Lie algebras is used
+	string input;						///< the input file of a run with --input, whose Lie algebras are named after their position; if empty, the run studied the classification
+	string only;						///< the selection of entries of the classification passed to --only, if any
+	int shard_count=0;				///< the number of shards of the run, if given
+	vector<string> shards;			///< the files containing the outputs of the shards
+};
+
+string merge_usage() {
+	return
+		"usage: gleipnir_merge [--classification FILE | --input FILE] [--only LIST] [--shards N] SHARD...\n"
+		"  merge the outputs of gleipnir --shard i/N --format json, in the order of the classification or of the input,\n"
+		"  and check that every entry studied by the run appears in a shard\n"
+		"  --classification FILE  the classification in FILE was used instead of the nilpotent Lie algebras of dimension 7\n"
+		"  --input FILE           the run studied the Lie algebras in FILE\n"
+		"  --only LIST            the run studied the entries of the classification in LIST\n"
+		"  --shards N             the run was divided into N shards, whose outputs must all be given\n";
+}
+
+MergeOptions parse_merge_options(int argc, char** argv) {
+	MergeOptions options;
+	for (int i=1;i<argc;++i) {
+		string arg=argv[i];
+		auto value=[&] () -> string {
+			if (++i==argc) throw invalid_argument(arg+" expects an argument");
+			return argv[i];
+		};
+		if (arg=="--classification") options.classification=value();
+		else if (arg=="--input") options.input=value();
+		else if (arg=="--only") options.only=value();
+		else if (arg=="--shards") options.shard_count=positive_integer(arg,value());
+		else if (arg.compare(0,2,"--")==0) throw invalid_argument("unknown option "+arg);
+		else options.shards.push_back(arg);
+	}
+	if (options.shards.empty()) throw invalid_argument("no shards given");
+	if (!options.input.empty() && (!options.classification.empty() || !options.only.empty())) throw invalid_argument("--input cannot be combined with --classification or --only");
+	if (options.shard_count && options.shards.size()!=options.shard_count)
+		throw invalid_argument("--shards "+std::to_string(options.shard_count)+" expects "+std::to_string(options.shard_count)+" shard outputs, got "+std::to_string(options.shards.size()));
+	return options;
+}
+
+/** Return the one-based position of a Lie algebra in the merged output
+	@param classification The classification studied by the run, or nullptr for runs with --input
+	@param name The name of the Lie algebra, as printed by gleipnir
+	@return The position of the entry with this name in the classification, or the position in the input encoded by the name
+	@exception std::runtime_error if the name is not the name of an entry of the classification, or not a positive integer for runs with --input
+*/
+int position(const Classification<LieGroup>* classification, const string& name) {
+	if (classification) {
+		if (int i=classification->find(name)) return i;
+		throw runtime_error("entry "+name+" is not in the classification");
+	}
+	size_t end=0;
+	int result=0;
+	try {result=std::stoi(name,&end);}
+	catch (const exception&) {end=0;}
+	if (end!=name.size() || result<=0) throw runtime_error("entry "+name+" is not a position in the input");
+	return result;
+}
+
+/** Return the one-based positions of the Lie algebras studied by a run, divided among the shards
+	@param options The options, which identify the classification or the input file and the selected entries
+	@param classification The classification, or nullptr for runs with --input
+*/
+vector<int> expected_positions(const MergeOptions& options, const Classification<LieGroup>* classification) {
+	vector<int> result;
+	if (!classification) {
+		ifstream input{options.input};
+		if (!input) throw runtime_error("cannot open "+options.input);
+		string line;
+		for (int i=1;next_lie_group_line(input,line);++i) result.push_back(i);
+	}
+	else if (options.only.empty())
+		for (int i=1;i<=classification->size();++i) result.push_back(i);
+	else
+		for (int i: select_entries(*classification,options.only)) result.push_back(i+1);
+	return result;
+}
+
+/** Reassemble the outputs of the shards of a run, @sa shard_tasks
+
+	Each shard must have been run with --format json. The lines of the shard outputs are printed in the order of the classification, or in the order of the input for runs with --input, where the Lie algebras are named after their position. Lines are copied verbatim, so that the result coincides with the output of a single run. Every entry studied by the run must appear in exactly one shard; otherwise, the missing entries are reported and the exit status is nonzero, even if they would have been assigned to a shard whose output was not given.
+*/
+int main(int argc, char** argv) {
+	try {
+		auto options=parse_merge_options(argc,argv);
+		unique_ptr<Classification<LieGroup>> classification;
+		if (options.input.empty()) {
+			if (options.classification.empty()) classification=make_unique<NilpotentLieGroups7>();
+			else classification=make_unique<ClassificationFile>(options.classification);
+		}
+		auto expected=expected_positions(options,classification.get());
+		map<int,string> lines;
+		for (auto& shard: options.shards) {
+			ifstream file{shard};
+			if (!file) throw runtime_error("cannot open "+shard);
+			string line;
+			for (int line_number=1;getline(file,line);++line_number) {
+				if (line.empty()) continue;
+				auto name=json_name(line);
+				if (!name) throw runtime_error(shard+":"+std::to_string(line_number)+": not in the format of --format json");
+				if (!lines.emplace(position(classification.get(),*name),line).second) throw runtime_error("entry "+*name+" appears in more than one shard");
+			}
+		}
+		for (auto& line: lines) cout<<line.second<<'\n';
+		cout<<flush;
+		vector<string> missing;
+		for (int i: expected)
+			if (!lines.count(i)) missing.push_back(classification? classification->name(OneBased{i}) : std::to_string(i));
+		if (!missing.empty()) {
+			cerr<<"entries missing from the shards: "<<horizontal(missing)<<endl;
+			return 1;
+		}
+	}
+	catch (const invalid_argument& e) {
+		cerr<<e.what()<<endl<<merge_usage();
+		return 1;
+	}
+	catch (const runtime_error& e) {
+		cerr<<e.what()<<endl;
+		return 1;
+	}
+}
@@ -0,0 +1,206 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODULAR_H
+#define MODULAR_H
+
+#include <cstdint>
+#include <optional>
+#include <iterator>
+#include <tuple>
+#include "sparselinear.h"
+
+/** Primes below 2^31, so that products of residues fit in 64 bits */
+constexpr uint32_t word_primes[]={
+	2147483647u, 2147483629u, 2147483587u, 2147483579u, 2147483563u, 2147483549u, 2147483543u, 2147483497u,
+	2147483489u, 2147483477u, 2147483423u, 2147483399u, 2147483353u, 2147483323u, 2147483269u, 2147483249u
+};
+
+inline uint32_t inverse_mod(uint32_t a, uint32_t p) {
+	int64_t r0=p, r1=a, s0=0, s1=1;
+	while (r1) {
+		int64_t q=r0/r1;
+		std::tie(r0,r1)=std::make_pair(r1,r0-q*r1);
+		std::tie(s0,s1)=std::make_pair(s1,s0-q*s1);
+	}
+	return s0<0? s0+p : s0;
+}
+
+/** A sparse linear system modulo a prime, kept in reduced row echelon form as rows are added */
+class ModularSystem {
+	using Row=std::vector<std::pair<int,uint32_t>>;
+	uint32_t p;
+	int columns;
+	std::map<int,Row> pivots;		///< rows with leading coefficient one, indexed by the column of the leading coefficient
+	uint32_t coefficient(const Row& row, int column) const {
+		auto i=lower_bound(row.begin(),row.end(),column,[] (const std::pair<int,uint32_t>& entry, int column) {return entry.first<column;});
+		return i!=row.end() && i->first==column? i->second : 0;
+	}
+/** Replace row by row-r*pivot, where r is the coefficient of row in the leading column of pivot */
+	void eliminate(Row& row, const Row& pivot, int column) const {
+		uint64_t r=coefficient(row,column);
+		if (!r) return;
+		Row result;
+		result.reserve(row.size()+pivot.size());
+		auto i=row.cbegin(), j=pivot.cbegin();
+		while (i!=row.cend() || j!=pivot.cend()) {
+			int col;
+			uint64_t value;
+			if (j==pivot.cend() || (i!=row.cend() && i->first<j->first)) {col=i->first; value=i->second; ++i;}
+			else if (i==row.cend() || j->first<i->first) {col=j->first; value=(p-r*j->second%p)%p; ++j;}
+			else {col=i->first; value=(i->second+p-r*j->second%p)%p; ++i; ++j;}
+			if (value) result.emplace_back(col,value);
+		}
+		row=std::move(result);
+	}
+public:
+/** Reduce a list of integer equations modulo a prime */
+	ModularSystem(const IntegerEquations& equations, uint32_t p) : p{p}, columns{equations.columns} {
+		for (auto& integer_row: equations.rows) {
+			Row row;
+			for (auto& entry: integer_row) {
+				uint32_t value=mpz_fdiv_ui(entry.second.get_mpz_t(),p);
+				if (value) row.emplace_back(entry.first,value);
+			}
+			add_row(std::move(row));
+		}
+	}
+	void add_row(Row row) {
+		for (auto& pivot: pivots) {
+			if (row.empty()) return;
+			eliminate(row,pivot.second,pivot.first);
+		}
+		if (row.empty()) return;
+		uint64_t inverse=inverse_mod(row.front().second,p);
+		for (auto& entry: row) entry.second=entry.second*inverse%p;
+		int column=row.front().first;
+		for (auto& pivot: pivots) eliminate(pivot.second,row,column);
+		pivots.emplace(column,std::move(row));
+	}
+	uint32_t prime() const {return p;}
+	int rank() const {return pivots.size();}
+	std::vector<int> pivot_columns() const {
+		std::vector<int> result;
+		for (auto& pivot: pivots) result.push_back(pivot.first);
+		return result;
+	}
+	std::vector<int> free_columns() const {
+		std::vector<int> result;
+		for (int i=0;i<columns;++i)
+			if (!pivots.count(i)) result.push_back(i);
+		return result;
+	}
+/** Return the entries of the kernel basis in the rows of the pivots, i.e. -a_f for each pivot row a and free column f, ordered by free column and then by pivot */
+	std::vector<uint32_t> kernel_entries() const {
+		std::vector<uint32_t> result;
+		for (int free: free_columns())
+			for (auto& pivot: pivots) {
+				auto a=coefficient(pivot.second,free);
+				result.push_back(a? p-a : 0);
+			}
+		return result;
+	}
+};
+
+/** Return the dimension of the space of solutions of a system of equations, computed modulo some primes
+	@param equations A list of equations with integer coefficients
+	@param primes The number of primes to use
+	@return The dimension of the space of solutions modulo the prime giving the largest rank, which is the dimension over Q unless all the primes are unlucky
+*/
+inline int modular_kernel_dimension(const IntegerEquations& equations, int primes=2) {
+	int rank=0;
+	for (int i=0;i<primes && i<std::size(word_primes);++i)
+		rank=std::max(rank,ModularSystem{equations,word_primes[i]}.rank());
+	return equations.columns-rank;
+}
+
+/** Find a fraction n/d congruent to a modulo m with |n|,d<=sqrt(m/2), if it exists */
+inline std::optional<mpq_class> rational_reconstruction(const mpz_class& a, const mpz_class& m) {
+	mpz_class bound=sqrt(mpz_class{m/2});
+	mpz_class r0=m, r1=a, s0=0, s1=1;
+	while (r1>bound) {
+		mpz_class q=r0/r1;
+		r0-=q*r1; swap(r0,r1);
+		s0-=q*s1; swap(s0,s1);
+	}
+	if (abs(s1)>bound || gcd(r1,s1)!=1) return std::nullopt;
+	mpq_class result{r1,s1};
+	result.canonicalize();
+	return result;
+}
+
+/** Compute a basis of the space of solutions of a system of integer equations by multi-modular elimination
+	@param equations A list of equations with integer coefficients
+	@return The basis obtained by setting one free variable equal to one and the others to zero, as in SparseLinearSystem::kernel, or nothing if the reconstruction did not succeed with the available primes
+
+	The system is reduced modulo word-size primes; primes giving a smaller rank or different pivots are discarded as unlucky. The entries of the kernel are combined by the Chinese remainder theorem and lifted to rationals by rational reconstruction; the result is returned only after checking that it satisfies the equations exactly. Since the solutions obtained are independent and their number is the corank modulo a prime, which is not smaller than the corank over Q, they form a basis.
+*/
+inline std::optional<std::vector<RationalRow>> multimodular_kernel(const IntegerEquations& equations) {
+	std::optional<ModularSystem> reference;
+	std::vector<mpz_class> residues;
+	mpz_class modulus=1;
+	for (auto p: word_primes) {
+		ModularSystem system{equations,p};
+		if (reference && (system.rank()<reference->rank() || (system.rank()==reference->rank() && system.pivot_columns()!=reference->pivot_columns()))) continue;
+		auto entries=system.kernel_entries();
+		if (!reference || system.rank()>reference->rank()) {
+			reference=system;
+			residues.assign(entries.begin(),entries.end());
+			modulus=p;
+		}
+		else {
+			mpz_class inverse=inverse_mod(mpz_fdiv_ui(modulus.get_mpz_t(),p),p);
+			for (int i=0;i<entries.size();++i) {
+				mpz_class correction=(entries[i]+p-mpz_fdiv_ui(residues[i].get_mpz_t(),p))*inverse%p;
+				residues[i]+=modulus*correction;
+			}
+			modulus*=p;
+		}
+		std::vector<RationalRow> kernel;
+		auto pivots=reference->pivot_columns();
+		auto residue=residues.begin();
+		bool reconstructed=true;
+		for (int free: reference->free_columns()) {
+			RationalRow solution;
+			solution[free]=1;
+			for (int pivot: pivots) {
+				auto x=rational_reconstruction(*residue++,modulus);
+				if (!x) {reconstructed=false; break;}
+				if (*x!=0) solution[pivot]=*x;
+			}
+			if (!reconstructed) break;
+			kernel.push_back(std::move(solution));
+		}
+		if (reconstructed && all_of(kernel.begin(),kernel.end(),[&equations] (const RationalRow& x) {return satisfies(equations,x);}))
+			return kernel;
+	}
+	return std::nullopt;
+}
+
+/** Compute a basis of the space of solutions of a system of integer equations
+	@param equations A list of equations with integer coefficients
+	@return The basis obtained by setting one free variable equal to one and the others to zero
+
+	The basis is computed by multi-modular elimination, falling back to fraction-free elimination over the integers if rational reconstruction fails. Either way the result is exact.
+*/
+inline std::vector<RationalRow> rational_kernel(const IntegerEquations& equations) {
+	if (auto kernel=multimodular_kernel(equations)) return *kernel;
+	return SparseLinearSystem{equations}.kernel();
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NICE_H
+#define NICE_H
+
+#include "nikolayevsky.h"
+
+/** Return the root matrix of a Lie algebra, if its basis is nice
+	@param c The structure constants of a Lie algebra, with or without parameters
+	@return The equations d_k-d_i-d_j=0 for each nonzero bracket [e_i,e_j]=c_ij^k e_k, without repetitions, or nothing if the basis is not nice
+
+	The basis is nice if each bracket [e_i,e_j] is a multiple of a single e_k, and for all i,k there is at most one j such that c_ij^k is nonzero. Then the diagonal part of any derivation is a derivation, and a diagonal matrix diag(d_1,...,d_n) is a derivation if and only if it satisfies the equations of the root matrix, which only depend on which structure constants are nonzero.
+*/
+optional<IntegerEquations> root_matrix(const StructureConstants& c) {
+	int n=c.dimension();
+	set<pair<int,int>> ik;
+	for (int i=0;i<n;++i)
+	for (int j=0;j<n;++j) {
+		auto bracket=c.bracket(i,j);
+		if (bracket.empty()) continue;
+		if (bracket.begin()+1!=bracket.end()) return nullopt;
+		if (!ik.emplace(i,bracket.begin()->k).second) return nullopt;
+	}
+	set<IntegerRow> rows;
+	for (auto ij: c.nonzero_brackets()) {
+		RationalRow row;
+		row[ij.first]-=1;
+		row[ij.second]-=1;
+		row[c.bracket(ij.first,ij.second).begin()->k]+=1;
+		auto integer_row=to_integer_row(row);
+		if (!integer_row.empty()) rows.insert(move(integer_row));
+	}
+	return IntegerEquations{n,{rows.begin(),rows.end()}};
+}
+
+/** Compute the Nikolayevsky derivation of a Lie algebra with a nice basis from its root matrix
+	@param c The structure constants of a Lie algebra without parameters
+	@return The eigenvalues n_1,...,n_n of the Nikolayevsky derivation, which is diagonal in the given basis, or nothing if the Lie algebra has parameters or the basis is not nice
+
+	Since the diagonal part of a derivation is a derivation, N=diag(n_1,...,n_n) satisfies tr(ND)=tr(D) for all derivations D if and only if it does for all diagonal derivations D; thus (n_1,...,n_n) is the orthogonal projection of (1,...,1) on the kernel of the root matrix. The projection is computed by exact rational linear algebra in a basis K_1,...,K_r of the kernel, solving sum_q (K_p,K_q) a_q=(K_p,(1,...,1)).
+*/
+optional<vector<mpq_class>> nice_nikolayevsky(const StructureConstants& c) {
+	if (!c.is_rational()) return nullopt;
+	auto roots=root_matrix(c);
+	if (!roots) return nullopt;
+	int n=c.dimension();
+	auto diagonal_derivations=SparseLinearSystem{*roots}.kernel();
+	int r=diagonal_derivations.size();
+	auto scalar_product=[] (const RationalRow& v, const RationalRow& w) {
+		mpq_class result=0;
+		for (auto& entry: v) {
+			auto i=w.find(entry.first);
+			if (i!=w.end()) result+=entry.second*i->second;
+		}
+		return result;
+	};
+	SparseLinearSystem gram{r+1};
+	for (int p=0;p<r;++p) {
+		RationalRow row;
+		for (int q=0;q<r;++q) row[q]=scalar_product(diagonal_derivations[p],diagonal_derivations[q]);
+		for (auto& entry: diagonal_derivations[p]) row[r]-=entry.second;
+		gram.add_row(row);
+	}
+	auto solutions=gram.kernel();	//the Gram matrix is invertible, so the only free column is r
+	if (solutions.size()!=1 || !solutions[0].count(r)) throw std::logic_error("singular Gram matrix of diagonal derivations");
+	vector<mpq_class> result(n);
+	for (auto& a: solutions[0])
+		if (a.first<r)
+			for (auto& entry: diagonal_derivations[a.first]) result[entry.first]+=a.second*entry.second;
+	return result;
+}
+
+/** Return the affine space N+W of derivations satisfying tr(ND)=tr(D) for all derivations D, with N given
+	@param form The trace form on the space of derivations of a Lie algebra without parameters
+	@param diagonal The eigenvalues of a diagonal matrix N, as computed by nice_nikolayevsky
+	@return an AffineSpaceInGl object representing N+W, where W is the kernel of the trace form, or nothing if N does not lie in the space of derivations or does not satisfy tr(ND)=tr(D)
+
+	This replaces solve_nikolayevsky_equations when N is known; the coordinates of N and the space W are computed by exact rational linear algebra in the coordinates of the space of derivations, so that the conditions on N are verified rather than solved for.
+*/
+optional<AffineSpaceInGl> nice_nikolayevsky_like_derivations(const TraceForm& form, const vector<mpq_class>& diagonal) {
+	int m=form.basis.size(), n=diagonal.size();
+	auto rational=[] (ex x) {return to_mpq(ex_to<numeric>(x));};
+	for (auto& D: form.matrices) {
+		mpq_class trace_of_ND=0;
+		for (int l=0;l<n;++l) trace_of_ND+=diagonal[l]*rational(D(l,l));
+		if (trace_of_ND!=rational(D.trace())) return nullopt;
+	}
+	SparseLinearSystem coordinates_of_N{m+1};		//sum_i x_iD_i-N=0, in the unknowns x_1,...,x_m,1
+	for (int l=0;l<n;++l)
+	for (int j=0;j<n;++j) {
+		RationalRow row;
+		for (int i=0;i<m;++i)
+			if (!form.matrices[i](l,j).is_zero()) row[i]=rational(form.matrices[i](l,j));
+		if (l==j && diagonal[l]!=0) row[m]=-diagonal[l];
+		coordinates_of_N.add_row(row);
+	}
+	auto pivots=coordinates_of_N.pivot_columns();
+	if (find(pivots.begin(),pivots.end(),m)!=pivots.end()) return nullopt;
+	exvector coefficients(m);
+	for (auto& entry: coordinates_of_N.kernel().back())		//the last free column is m
+		if (entry.first<m) coefficients[entry.first]=to_numeric(entry.second);
+	AffineSpaceInGl result;
+	result.trace_form=form;
+	linear_combination(form,coefficients,result.N,result.N_as_matrix);
+	SparseLinearSystem kernel_of_trace_form{m};
+	for (int j=0;j<form.gram.rows();++j) {
+		RationalRow row;
+		for (int i=0;i<m;++i)
+			if (!form.gram(j,i).is_zero()) row[i]=rational(form.gram(j,i));
+		kernel_of_trace_form.add_row(row);
+	}
+	for (auto& w: kernel_of_trace_form.kernel()) {
+		fill(coefficients.begin(),coefficients.end(),0);
+		for (auto& entry: w) coefficients[entry.first]=to_numeric(entry.second);
+		ex element; matrix M;
+		linear_combination(form,coefficients,element,M);
+		result.W_basis.push_back(element);
+		result.W_as_matrices.push_back(M);
+	}
+	result.W=VectorSpace<DifferentialForm>{result.W_basis};
+	return result;
+}
+
+#endif
@@ -0,0 +1,380 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it      
+                                                                     
+    This file is part of Gleipnir
+	                                                                     
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NIKOLAYEVSKY_H
+#define NIKOLAYEVSKY_H
+
+#include "derivations.h"
+#include "horizontal.h"
+#include "eigenvalues.h"
+
+/** Return tr(AB) for square matrices of the same size, without computing the product */
+ex trace_of_product(const matrix& A, const matrix& B) {
+	ex result;
+	for (int l=0;l<A.rows();++l)
+	for (int i=0;i<A.cols();++i)
+		if (!A(l,i).is_zero() && !B(i,l).is_zero()) result+=A(l,i)*B(i,l);
+	return result.expand();
+}
+
+/** The trace form tr(XY) on a space of derivations, evaluated on a subspace */
+struct TraceForm {
+	exvector basis;				///< a basis D_1,...,D_m of the space of derivations, as elements of gl
+	exvector coordinates;		///< the coordinates of the space of derivations relative to the basis D_1,...,D_m
+	vector<matrix> matrices;	///< the matrices of D_1,...,D_m
+	matrix gram;						///< the matrix whose entry (j,i) is tr(E_jD_i), where E_1,...,E_k is a basis of the subspace
+	exvector traces;				///< the traces tr(E_1),...,tr(E_k)
+};
+
+/** Compute the trace form on a space of derivations
+	@param der A space of derivations
+	@param subspace A subspace of der, on which the condition tr(ND)=tr(D) is imposed
+	@param gl The Lie algebra of GL(n,R)
+	@return The Gram matrix of the trace form, relative to the basis of der and the given basis of the subspace, together with the traces of the elements of subspace
+
+	Each element of either basis is converted to a matrix exactly once, and each entry of the Gram matrix is computed as a sum over the nonzero entries, without forming the products of matrices.
+*/
+TraceForm trace_form(const VectorSpace<DifferentialForm>& der, const exvector& subspace, const GL& gl) {
+	TraceForm result;
+	result.coordinates.assign(der.coordinate_begin(),der.coordinate_end());
+	auto generic_element=der.GenericElement().expand();
+	for (auto x: result.coordinates) {
+		result.basis.push_back(generic_element.coeff(x));
+		result.matrices.push_back(gl.glToMatrix(result.basis.back()));
+	}
+	vector<matrix> subspace_matrices;
+	for (auto E: subspace) {
+		auto i=find_if(result.basis.begin(),result.basis.end(),[&E] (ex D) {return D.is_equal(E);});
+		subspace_matrices.push_back(i!=result.basis.end()? result.matrices[i-result.basis.begin()] : gl.glToMatrix(E));
+	}
+	result.gram=matrix(subspace.size(),result.basis.size());
+	for (int j=0;j<subspace_matrices.size();++j) {
+		for (int i=0;i<result.matrices.size();++i)
+			result.gram(j,i)=trace_of_product(subspace_matrices[j],result.matrices[i]);
+		result.traces.push_back(subspace_matrices[j].trace());
+	}
+	return result;
+}
+
+/** Return the linear equations corresponding to tr(ND)=tr(D) for all D in some subspace of gl
+	@param form The trace form, as returned by trace_form
+	@return The equations sum_i gram(j,i)x_i=tr(E_j) for N=sum_i x_iD_i, as expressions in the coordinates x_i
+*/
+exvector nikolayevsky_equations(const TraceForm& form) {
+	set<ex,ex_is_less> eqns;
+	for (int j=0;j<form.gram.rows();++j) {
+		ex eq=-form.traces[j];
+		for (int i=0;i<form.gram.cols();++i) eq+=form.gram(j,i)*form.coordinates[i];
+		eq=eq.expand();
+		if (!eq.is_zero()) eqns.insert(eq);
+	}
+	return {eqns.begin(),eqns.end()};
+}
+
+/** An affine space N+W in gl(n,R) */
+struct AffineSpaceInGl {
+	ex N;
+	VectorSpace<DifferentialForm> W;
+	matrix N_as_matrix;				///< the matrix of N
+	exvector W_basis;					///< the basis of W obtained from the trace form
+	vector<matrix> W_as_matrices;	///< the matrices of the elements of W_basis
+	TraceForm trace_form;			///< the trace form from which N and W were obtained
+};
+
+/** Compute a linear combination of the basis of a space of derivations, both as an element of gl and as a matrix
+	@param form The trace form on the space of derivations
+	@param coefficients The coefficients x_1,...,x_m
+	@param element Set to sum_i x_iD_i
+	@param M Set to the matrix of element, computed from the matrices in form
+*/
+void linear_combination(const TraceForm& form, const exvector& coefficients, ex& element, matrix& M) {
+	int n=form.matrices.empty()? 0 : form.matrices[0].rows();
+	element=0;
+	M=matrix(n,n);
+	for (int i=0;i<coefficients.size();++i) {
+		if (coefficients[i].is_zero()) continue;
+		element+=coefficients[i]*form.basis[i];
+		M=M.add(form.matrices[i].mul_scalar(coefficients[i]));
+	}
+	element=element.expand();
+}
+
+/** Solve the equations tr(ND)=tr(D) for N in a space of derivations
+	@param form The trace form on the space of derivations
+	@param eqns The equations, as returned by nikolayevsky_equations
+	@return an AffineSpaceInGl object representing the affine space N+W of solutions, where N is obtained by setting the free coordinates to zero
+
+	The system is solved in the m coordinates of the space of derivations, and the matrices of N and of the basis of W are obtained as linear combinations of the matrices in form, without further conversions.
+*/
+AffineSpaceInGl solve_nikolayevsky_equations(const TraceForm& form, const exvector& eqns) {
+	AffineSpaceInGl result;
+	result.trace_form=form;
+	auto solution=solve_by_components(lst{eqns.begin(),eqns.end()},lst{form.coordinates.begin(),form.coordinates.end()});
+	if (solution==lst{}) throw std::runtime_error("the equations tr(ND)=tr(D) have no solution");
+	exmap free_to_zero;
+	exvector free;
+	for (auto x: solution)
+		if (x.lhs()==x.rhs()) {
+			free.push_back(x.lhs());
+			free_to_zero[x.lhs()]=0;
+		}
+	exvector coefficients;
+	for (auto x: solution) coefficients.push_back(x.rhs().subs(free_to_zero));
+	linear_combination(form,coefficients,result.N,result.N_as_matrix);
+	for (auto f: free) {
+		coefficients.clear();
+		for (auto x: solution) coefficients.push_back(x.rhs().expand().coeff(f));
+		ex w; matrix M;
+		linear_combination(form,coefficients,w,M);
+		result.W_basis.push_back(w);
+		result.W_as_matrices.push_back(M);
+	}
+	result.W=VectorSpace<DifferentialForm>{result.W_basis};
+	return result;
+}
+
+/** Return the affine space N+W of derivations satisfying tr(ND)=tr(D) for all derivations D
+	@param G a Lie group of dimension n without parameters
+	@param gl The Lie algebra of GL(n,R).
+	@return an AffineSpaceInGl object representing the affine space N+W
+	
+	The computation is performed by computing the space of derivations exactly
+*/
+AffineSpaceInGl nikolayevsky_like_derivations(const LieGroup& G, const GL& gl) {
+	auto der=derivations(G,gl);
+	auto form=trace_form(der,der.e(),gl);
+	return solve_nikolayevsky_equations(form,nikolayevsky_equations(form));
+}
+
+/** Return an affine space N+W that is guaranteed to contain the Nikolayevsky derivation
+	@param G a Lie group of dimension n, with or without parameters
+	@param c The structure constants of G
+	@param gl The Lie algebra of GL(n,R).
+	@return an AffineSpaceInGl object representing the affine space N+W
+	
+	The computation is performed like in the case without parameters (@sa nikolayevsky_like_derivations), except that the space of derivations cannot be determined exactly, but only as a VectorSpaceBetween object. This implies that the resulting space N+W may contain elements that are not derivations, or do not satisfy tr(ND)=tr(D) for all derivations.
+*/
+AffineSpaceInGl nikolayevsky_like_derivations_parametric(const LieGroup& G, const StructureConstants& c, const GL& gl) {
+	auto derivations=derivations_parametric<StructureConstant>(G,c,gl);
+	VectorSpace<DifferentialForm> der{derivations.basis_of_larger_space};
+	auto form=trace_form(der,derivations.basis_of_smaller_space,gl);
+	return solve_nikolayevsky_equations(form,nikolayevsky_equations(form));
+}
+
+/** Return a basis of the kernel of a linear map restricted to a subspace
+	@param basis A basis v_1,...,v_k of the subspace
+	@param images The images of v_1,...,v_k, as sparse vectors
+	@return A basis of the space of linear combinations of v_1,...,v_k whose image is zero
+
+	If all the images have rational entries, the kernel is computed exactly by SparseLinearSystem; otherwise, by PolynomialLinearSystem.
+*/
+exvector kernel_in_span(const exvector& basis, const vector<map<int,ex>>& images) {
+	int k=basis.size();
+	map<int,map<int,ex>> rows;		//rows[p][f] is the component p of the image of v_f
+	bool rational=true;
+	for (int f=0;f<k;++f)
+		for (auto& entry: images[f]) {
+			rows[entry.first][f]=entry.second;
+			rational=rational && is_a<numeric>(entry.second) && ex_to<numeric>(entry.second).is_rational();
+		}
+	vector<map<int,ex>> kernel;
+	if (rational) {
+		SparseLinearSystem system{k};
+		for (auto& row: rows) {
+			RationalRow rational_row;
+			for (auto& entry: row.second) rational_row[entry.first]=to_mpq(ex_to<numeric>(entry.second));
+			system.add_row(rational_row);
+		}
+		for (auto& solution: system.kernel()) {
+			map<int,ex> combination;
+			for (auto& entry: solution) combination[entry.first]=to_numeric(entry.second);
+			kernel.push_back(move(combination));
+		}
+	}
+	else {
+		PolynomialLinearSystem system{k+1};
+		for (auto& row: rows) system.add_row(PolynomialRow{row.second.begin(),row.second.end()});
+		kernel=system.kernel();
+	}
+	exvector result;
+	for (auto& combination: kernel) {
+		ex element;
+		for (auto& entry: combination) element+=entry.second*basis[entry.first];
+		result.push_back(element.expand());
+	}
+	return result;
+}
+
+/** Return the centralizer of a matrix N inside a subspace W of gl
+	@param N an n by n matrix
+	@param W_basis a basis of W, as elements of gl
+	@param W_matrices the matrices of the elements of W_basis
+	@return The space of elements of W that commute with N
+
+	The centralizer is computed as the kernel of ad_N, as a linear map from W to the space of n by n matrices. If N is diagonal, the (l,i) entry of [N,X] is (N_ll-N_ii)X_li, so the kernel is defined by the entries of the X in W_basis for the positions (l,i) where the eigenvalues differ, and no product is computed.
+*/
+VectorSpace<DifferentialForm> centralizer(const matrix& N, const exvector& W_basis, const vector<matrix>& W_matrices) {
+	int n=N.rows();
+	bool diagonal=true;
+	for (int l=0;l<n;++l)
+	for (int i=0;i<n;++i)
+		if (l!=i && !N(l,i).is_zero()) diagonal=false;
+	vector<map<int,ex>> images;
+	if (diagonal) {
+		vector<bool> distinct_eigenvalues(n*n);
+		for (int l=0;l<n;++l)
+		for (int i=0;i<n;++i)
+			distinct_eigenvalues[l*n+i]=!(N(l,l)-N(i,i)).normal().is_zero();
+		for (auto& M: W_matrices) {
+			map<int,ex> image;
+			for (int li=0;li<n*n;++li)
+				if (distinct_eigenvalues[li] && !M(li/n,li%n).is_zero()) image[li]=M(li/n,li%n);
+			images.push_back(move(image));
+		}
+	}
+	else 
+		for (auto& M: W_matrices) {
+			auto commutator=N.mul(M).sub(M.mul(N));
+			map<int,ex> image;
+			for (int li=0;li<n*n;++li) {
+				ex entry=commutator(li/n,li%n).expand();
+				if (!entry.is_zero()) image[li]=entry;
+			}
+			images.push_back(move(image));
+		}
+	auto basis=kernel_in_span(W_basis,images);
+	return VectorSpace<DifferentialForm>{basis};
+}
+
+/** Return the centralizer of an element N of gl inside a subspace of gl
+	@param N an element of gl
+	@param W a subspace of gl
+	@param gl The Lie algebra of GL(n,R)
+	@return The space of elements of W that commute with N
+*/
+VectorSpace<DifferentialForm> centralizer(ex N, const VectorSpace<DifferentialForm>& W, const GL& gl) {
+	auto W_basis=W.e();
+	vector<matrix> W_matrices;
+	for (auto X: W_basis) W_matrices.push_back(gl.glToMatrix(X));
+	return centralizer(gl.glToMatrix(N),exvector{W_basis.begin(),W_basis.end()},W_matrices);
+}
+
+/** Return the centralizer of N inside W, for an affine space N+W computed from the trace form
+	@param nik an AffineSpaceInGl object, as returned by solve_nikolayevsky_equations
+	@return The space of elements of W that commute with N
+
+	The matrices of N and of the basis of W computed from the trace form are reused, so that no conversion between gl and matrices takes place.
+*/
+VectorSpace<DifferentialForm> centralizer(const AffineSpaceInGl& nik) {
+	return centralizer(nik.N_as_matrix,nik.W_basis,nik.W_as_matrices);
+}
+
+/** Return the set of linear equations that a matrix should satisfy in order to define a derivation
+	@param G a Lie group of dimension n
+	@param c The structure constants of G
+	@param gl The Lie algebra of GL(n,R)
+	@param matrix an element of gl
+	@result the equations that must be satisfied for the matrix to define a derivation of the Lie algebra of G
+*/	
+auto derivation_when(const LieGroup& G, const StructureConstants& c, const GL& gl, ex matrix) {
+	auto brackets=Xbrackets(G,c,GLRepresentation<VectorField>(&gl,G.e()),matrix);
+	set<ex,ex_is_less> eqns;
+	GetCoefficients<VectorField>(eqns,brackets);
+	eqns.erase(0);
+	return eqns;
+}
+
+
+/** Print the generic derivation and the conditions for it to be a derivation
+	@return The generic derivation, as a matrix
+*/
+matrix print_derivations(const LieGroup& G, const StructureConstants& c, const GL& gl, ostream& os) {
+	VectorSpace<DifferentialForm> der{derivations_parametric<StructureConstant>(G,c,gl).basis_of_larger_space};
+	auto gen_der=gl.glToMatrix(der.GenericElement());
+	os<<dflt;
+	os<<"generic derivation "<<gen_der<<endl;
+	os<<"derivation when the following are zero: "<<derivation_when(G,c,gl,der.GenericElement())<<endl;	
+	os<<latex;
+	return gen_der;
+}
+
+/** A candidate for the Nikolayevsky derivation, with the conditions for it to be a derivation
+
+	If the candidate is a derivation but is not diagonal, its characteristic and minimal polynomials are computed exactly over Q(parameters) to decide whether it is diagonalizable, @sa eigenvalue_analysis.
+*/
+class Nikolayevsky {
+	matrix N;
+	set<ex,ex_is_less> derivation_when;
+	optional<EigenvalueAnalysis> analysis;	///< computed if N is a derivation and is not diagonal
+	bool is_diagonal() const {
+		for (int i=0;i<N.cols();++i)
+		for (int j=i+1;j<N.cols();++j)	
+			if (!N(i,j).is_zero() || !N(j,i).is_zero()) return false;
+		return true;	
+	}
+	exvector diagonal() const {
+			exvector diagonal;		
+			for (int i=0;i<N.cols();++i)
+				diagonal.push_back(N(i,i));
+			return diagonal;
+	}	
+	void analyze() {
+		if (derivation_when.empty() && !is_diagonal()) analysis=::eigenvalue_analysis(N);
+	}
+public:
+	Nikolayevsky(const LieGroup& G, const StructureConstants& c, const GL& gl, ex nik) {
+		N=gl.glToMatrix(nik);
+		derivation_when=::derivation_when(G,c,gl,nik);	
+		analyze();
+	}
+/** Construct from the matrix of the candidate and the conditions for it to be a derivation, if these have already been computed */
+	Nikolayevsky(const matrix& N, const set<ex,ex_is_less>& derivation_when) : N{N}, derivation_when{derivation_when} {
+		analyze();
+	}
+	string to_string() const {
+			stringstream result;
+			if (!derivation_when.empty()) 
+				result<<"cannot compute; Nikolayevsky derivation takes the form "<<N<<", only derivation when the following are zero: "<<derivation_when;			
+			else if (is_diagonal()) 
+				result<<horizontal(diagonal());
+			else if (analysis->diagonalizable()) {
+				result<<horizontal(analysis->diagonal())<<" in the basis";
+				for (auto& v: analysis->diagonalizing_basis) result<<" "<<lst{v.begin(),v.end()};
+				result<<" of eigenvectors of "<<N;
+			}
+			else if (analysis->semisimple)
+				result<<"semisimple with eigenvalues not in the base field, minimal polynomial "<<analysis->minimal_polynomial<<", "<<N;
+			else 
+				result<<"not semisimple, minimal polynomial "<<analysis->minimal_polynomial<<", "<<N;
+			return result.str() ;
+	}
+/** Return true if the candidate is a derivation and is diagonalizable over Q(parameters), so that it is the Nikolayevsky derivation */
+	bool computed() const {
+		return derivation_when.empty() && (is_diagonal() || analysis->diagonalizable());
+	}
+/** The eigenvalues of the Nikolayevsky derivation, with repetitions; meaningful only if computed() is true */
+	exvector eigenvalues() const {
+		return is_diagonal()? diagonal() : analysis->diagonal();
+	}
+	const matrix& as_matrix() const {return N;}
+	const set<ex,ex_is_less>& conditions() const {return derivation_when;}
+/** The eigenvalue analysis of N, if N is a derivation that is not diagonal */
+	const optional<EigenvalueAnalysis>& eigenvalue_analysis() const {return analysis;}
+};
+
+#endif
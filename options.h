@@ -0,0 +1,179 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "shard.h"
+
+/** The options passed on the command line */
+struct Options {
+	int jobs=1;										///< number of worker processes used to study a classification
+	std::vector<std::string> algebras;	///< Lie algebras given explicitly by their structure constants; if empty, the classification is used
+	std::string cache;								///< directory of the result cache; if empty, no cache is used
+	int timeout=0;									///< wall-clock limit in seconds for each entry of the classification; zero means no limit
+	long memory=0;									///< memory limit in megabytes for each entry of the classification; zero means no limit
+	std::string checkpoint;						///< file where processed entries are journaled; if empty, no journal is kept
+	bool resume=false;							///< if true, entries that completed according to the checkpoint file are not recomputed
+	bool screen=false;							///< if true, only print the dimension of the derivation algebra, computed modulo primes
+	bool fingerprint=false;					///< if true, only print invariants of each Lie algebra, flagging those that coincide with earlier ones up to relabeling or have the same invariants, @sa Deduplicator
+	bool deduplicate=false;					///< if true, Lie algebras that coincide with earlier ones or with Lie algebras in the store, up to relabeling, are not studied again
+	std::string classification;				///< data file containing the classification, @sa ClassificationFile; if empty, the classification of seven-dimensional nilpotent Lie algebras is used
+	std::string only;								///< the entries of the classification to study, @sa select_entries; if empty, all entries are studied
+	std::string input;								///< file containing one Lie algebra per line, or - for standard input; if empty, the Lie algebras are given explicitly or taken from the classification
+	int specialize=0;								///< if positive, the number of threads used to compute the Nikolayevsky derivation of Lie algebras with a parameter by specializing it
+	int threads=1;									///< the number of threads used to solve independent blocks of the equations for the derivations of each Lie algebra
+	bool json=false;								///< if true, print one JSON object per Lie algebra instead of LaTeX text
+	std::string store;								///< file where the results are appended, indexed by the name of the Lie algebra; if empty, no store is kept
+	Shard shard;										///< the part of the classification or of the input file studied by this run, @sa shard_tasks
+	std::string serve;								///< Unix socket where requests are accepted, @sa Server; if empty, the program does not act as a server
+	int answer_cache=64;							///< the memory in megabytes used by the server to keep answers for repeated requests, @sa AnswerCache
+	std::string metrics;							///< file where the progress of the run is written periodically in the Prometheus text format, @sa Progress; if empty, no metrics are written
+	bool progress=false;							///< if true, a progress line is written periodically on standard error
+	std::string timings;							///< file where the time taken by each Lie algebra is recorded and read back to estimate costs, @sa CostModel; if empty, costs are estimated from the structure constants alone
+	bool isolate() const {return jobs>1 || timeout || memory || !checkpoint.empty();}	///< true if entries must be studied in child processes
+	bool monitor() const {return progress || !metrics.empty();}	///< true if the progress of the run must be reported
+};
+
+inline std::string usage() {
+	return
+		"usage: gleipnir [options] [structure constants]\n"
+		"  --jobs N    study the entries of the classification in N worker processes\n"
+		"  --cache DIR reuse and store results in the cache directory DIR\n"
+		"  --timeout S give up on an entry of the classification after S seconds\n"
+		"  --memory MB give up on an entry of the classification if it needs more than MB megabytes\n"
+		"  --checkpoint FILE\n"
+		"              journal processed entries in FILE\n"
+		"  --resume    continue the run journaled in the checkpoint file, retrying the\n"
+		"              entries that did not complete\n"
+		"  --classification FILE\n"
+		"              study the classification in FILE instead of the nilpotent Lie algebras of dimension 7\n"
+		"  --only LIST study only the entries of the classification in LIST, e.g. 137,140-150\n"
+		"  --input FILE\n"
+		"              study the Lie algebras in FILE, one per line, or in standard input if FILE is -\n"
+		"  --screen    only print the dimension of the derivation algebra, computed modulo primes\n"
+		"  --fingerprint\n"
+		"              only print invariants of each Lie algebra, computed modulo a prime, flagging Lie algebras\n"
+		"              that coincide with earlier ones up to relabeling the basis, or have the same invariants\n"
+		"  --deduplicate\n"
+		"              do not study Lie algebras that coincide with earlier ones or with Lie algebras in the store,\n"
+		"              up to relabeling the basis\n"
+		"  --specialize T\n"
+		"              for Lie algebras depending on a parameter, also compute the Nikolayevsky derivation\n"
+		"              for generic values of the parameter, solving specializations in T threads\n"
+		"  --threads T solve independent blocks of the equations for the derivations in T threads\n"
+		"  --format F  print the results as text (the default) or as json, one object per line\n"
+		"  --store FILE\n"
+		"              append the results to FILE, indexed by the name of the Lie algebra\n"
+		"  --shard i/N study the i-th of N parts of the classification or of the input file, balanced by estimated cost\n"
+		"  --serve SOCKET\n"
+		"              answer requests on the Unix socket SOCKET, one Lie algebra per line, with one JSON object per line\n"
+		"  --answer-cache MB\n"
+		"              keep at most MB megabytes of answers in the server for repeated requests (default 64)\n"
+		"  --metrics FILE\n"
+		"              write the progress of the run and the time spent in each stage to FILE every second,\n"
+		"              in the Prometheus text format\n"
+		"  --progress  write a progress line on standard error every second\n"
+		"  --timings FILE\n"
+		"              record the time taken by each Lie algebra in FILE, and use the times recorded by previous runs\n"
+		"              to start the most expensive entries first\n";
+}
+
+/** Convert a command line argument to a positive integer
+	@param option The name of the option, used in error messages
+	@param value The argument
+	@return The integer represented by value
+	@exception std::invalid_argument if value does not represent a positive integer
+*/
+inline int positive_integer(const std::string& option, const std::string& value) {
+	size_t end=0;
+	int result=0;
+	try {result=std::stoi(value,&end);}
+	catch (const std::exception&) {end=0;}
+	if (end!=value.size() || result<=0) throw std::invalid_argument(option+" expects a positive integer, got "+value);
+	return result;
+}
+
+/** Parse the command line
+	@param argc The number of arguments, as passed to main
+	@param argv The arguments, as passed to main
+	@return The parsed options
+	@exception std::invalid_argument if the command line is not valid
+*/
+inline Options parse_options(int argc, char** argv) {
+	Options options;
+	bool answer_cache_given=false;
+	for (int i=1;i<argc;++i) {
+		std::string arg=argv[i];
+		auto value=[&] () -> std::string {
+			if (++i==argc) throw std::invalid_argument(arg+" expects an argument");
+			return argv[i];
+		};
+		if (arg=="--jobs") options.jobs=positive_integer(arg,value());
+		else if (arg=="--cache") options.cache=value();
+		else if (arg=="--timeout") options.timeout=positive_integer(arg,value());
+		else if (arg=="--memory") options.memory=positive_integer(arg,value());
+		else if (arg=="--checkpoint") options.checkpoint=value();
+		else if (arg=="--resume") options.resume=true;
+		else if (arg=="--classification") options.classification=value();
+		else if (arg=="--only") options.only=value();
+		else if (arg=="--input") options.input=value();
+		else if (arg=="--screen") options.screen=true;
+		else if (arg=="--fingerprint") options.fingerprint=true;
+		else if (arg=="--deduplicate") options.deduplicate=true;
+		else if (arg=="--specialize") options.specialize=positive_integer(arg,value());
+		else if (arg=="--threads") options.threads=positive_integer(arg,value());
+		else if (arg=="--format") {
+			auto format=value();
+			if (format!="text" && format!="json") throw std::invalid_argument("--format expects text or json, got "+format);
+			options.json=format=="json";
+		}
+		else if (arg=="--store") options.store=value();
+		else if (arg=="--shard") options.shard=parse_shard(value());
+		else if (arg=="--serve") options.serve=value();
+		else if (arg=="--answer-cache") {
+			options.answer_cache=positive_integer(arg,value());
+			answer_cache_given=true;
+		}
+		else if (arg=="--metrics") options.metrics=value();
+		else if (arg=="--progress") options.progress=true;
+		else if (arg=="--timings") options.timings=value();
+		else if (arg.compare(0,2,"--")==0) throw std::invalid_argument("unknown option "+arg);
+		else options.algebras.push_back(arg);
+	}
+	if (options.resume && options.checkpoint.empty()) throw std::invalid_argument("--resume requires --checkpoint");
+	if (!options.input.empty() && !options.algebras.empty()) throw std::invalid_argument("--input cannot be combined with Lie algebras on the command line");
+	if (!options.input.empty() && !options.checkpoint.empty()) throw std::invalid_argument("--checkpoint is only supported for the classification");
+	if ((!options.classification.empty() || !options.only.empty()) && (!options.input.empty() || !options.algebras.empty())) 
+		throw std::invalid_argument("--classification and --only cannot be combined with --input or Lie algebras on the command line");
+	if (options.shard.count>1 && (!options.algebras.empty() || options.input=="-"))
+		throw std::invalid_argument("--shard requires the classification or an input file");
+	if (!options.serve.empty() && (!options.algebras.empty() || !options.input.empty() || !options.classification.empty() || !options.only.empty() || !options.checkpoint.empty() || options.shard.count>1 || options.screen || options.fingerprint || options.deduplicate || !options.timings.empty()))
+		throw std::invalid_argument("--serve cannot be combined with Lie algebras to study, --checkpoint, --shard, --screen, --fingerprint, --deduplicate or --timings");
+	if (answer_cache_given && options.serve.empty()) throw std::invalid_argument("--answer-cache requires --serve");
+	if (options.monitor() && (!options.serve.empty() || options.screen || options.fingerprint))
+		throw std::invalid_argument("--metrics and --progress cannot be combined with --serve, --screen or --fingerprint");
+	if (options.fingerprint && options.screen) throw std::invalid_argument("--fingerprint cannot be combined with --screen");
+	if (options.deduplicate && (options.screen || options.fingerprint)) throw std::invalid_argument("--deduplicate cannot be combined with --screen or --fingerprint");
+	return options;
+}
+
+#endif
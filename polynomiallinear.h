@@ -0,0 +1,224 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POLYNOMIALLINEAR_H
+#define POLYNOMIALLINEAR_H
+
+#include <ginac/ginac.h>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <algorithm>
+
+/** A sparse row whose coefficients are polynomials in some parameters, stored as pairs (column, coefficient) in increasing order of column, with no zero coefficients */
+using PolynomialRow = std::vector<std::pair<int,GiNaC::ex>>;
+
+/** Return the coefficient of a row in a given column, or zero */
+inline GiNaC::ex coefficient(const PolynomialRow& row, int column) {
+	auto i=lower_bound(row.begin(),row.end(),column,[] (const std::pair<int,GiNaC::ex>& entry, int column) {return entry.first<column;});
+	return i!=row.end() && i->first==column? i->second : GiNaC::ex{0};
+}
+
+/** Clear the denominators of a row and divide it by the gcd of its coefficients, so that the coefficients are coprime polynomials with integer coefficients
+	@return The gcd the row has been divided by, after clearing denominators
+*/
+inline GiNaC::ex remove_content(PolynomialRow& row) {
+	if (row.empty()) return 1;
+	GiNaC::ex denominator=1;
+	for (auto& entry: row) denominator=lcm(denominator,entry.second.denom());
+	GiNaC::ex content=0;
+	for (auto& entry: row) {
+		if (!denominator.is_equal(1)) entry.second=(entry.second*denominator).normal();
+		if (!content.is_equal(1)) content=gcd(content,entry.second);
+	}
+	if (content.is_equal(1)) return content;
+	for (auto& entry: row) {
+		GiNaC::ex quotient;
+		divide(entry.second,content,quotient);
+		entry.second=quotient;
+	}
+	return content;
+}
+
+/** A sparse linear system whose coefficients are polynomials in some parameters, solved by fraction-free Gauss-Jordan elimination.
+
+	This is the analogue of SparseLinearSystem over Q[parameters]. Rows are combined as in Bareiss' algorithm, by cross-multiplying with the pivot and dividing by a common factor, and every row is divided by the gcd of its coefficients after each step, so that coefficients do not grow. Numeric pivots are preferred over pivots that depend on the parameters, since dividing by them is valid for all values of the parameters; the solution is valid where the pivots are nonzero, as for lsolve.
+
+	The last column represents the constant term, so that the rows correspond to affine equations in columns-1 unknowns.
+*/
+class PolynomialLinearSystem {
+	int columns;
+	std::map<int,PolynomialRow> pivots;	///< rows in reduced form, indexed by their pivot column, which does not appear in other rows
+	bool consistent=true;
+	std::set<GiNaC::ex,GiNaC::ex_is_less> contents;	///< the nonconstant polynomials rows have been divided by
+
+	static bool is_numeric(const GiNaC::ex& x) {return GiNaC::is_a<GiNaC::numeric>(x);}
+	void divide_by_content(PolynomialRow& row) {
+		auto content=remove_content(row);
+		if (!is_numeric(content)) contents.insert(content);
+	}
+/** Replace row by p*row-r*pivot, where p and r are the coefficients of pivot and row in the pivot column, divided by their gcd */
+	void eliminate(PolynomialRow& row, const PolynomialRow& pivot, int column) {
+		GiNaC::ex r=coefficient(row,column);
+		if (r.is_zero()) return;
+		GiNaC::ex p=coefficient(pivot,column);
+		GiNaC::ex g=gcd(p,r), row_factor, pivot_factor;
+		divide(p,g,row_factor);
+		divide(r,g,pivot_factor);
+		PolynomialRow result;
+		result.reserve(row.size()+pivot.size());
+		auto i=row.cbegin(), j=pivot.cbegin();
+		while (i!=row.cend() || j!=pivot.cend()) {
+			GiNaC::ex value;
+			int col;
+			if (j==pivot.cend() || (i!=row.cend() && i->first<j->first)) {col=i->first; value=(row_factor*i->second).expand(); ++i;}
+			else if (i==row.cend() || j->first<i->first) {col=j->first; value=(-pivot_factor*j->second).expand(); ++j;}
+			else {col=i->first; value=(row_factor*i->second-pivot_factor*j->second).expand(); ++i; ++j;}
+			if (!value.is_zero()) result.emplace_back(col,std::move(value));
+		}
+		divide_by_content(result);
+		row=std::move(result);
+	}
+/** Choose the pivot column of a reduced row: the first column with a numeric coefficient if any, otherwise the first column
+	
+	If the system has numeric coefficients, this makes the reduced form unique, so that the solution coincides with the one computed by Gauss elimination.
+*/
+	int choose_pivot(const PolynomialRow& row) const {
+		int result=-1;
+		for (auto& entry: row) {
+			if (entry.first==columns-1) break;
+			if (is_numeric(entry.second)) return entry.first;
+			if (result<0) result=entry.first;
+		}
+		return result;
+	}
+public:
+	explicit PolynomialLinearSystem(int columns) : columns{columns} {}
+	int number_of_columns() const {return columns;}
+/** Add the equation sum_i row[i] x_i + row[columns-1] = 0 to the system */
+	void add_row(PolynomialRow row) {
+		divide_by_content(row);
+		for (auto& pivot: pivots) {
+			if (row.empty()) return;
+			eliminate(row,pivot.second,pivot.first);
+		}
+		if (row.empty()) return;
+		int column=choose_pivot(row);
+		if (column<0) {consistent=false; return;}
+		for (auto& pivot: pivots) eliminate(pivot.second,row,column);
+		pivots.emplace(column,std::move(row));
+	}
+/** False if the system contains an equation of the form c=0 with c a nonzero constant */
+	bool is_consistent() const {return consistent;}
+	int rank() const {return pivots.size();}
+/** Return polynomials in the parameters such that the specialized system has the same rank at all values where none of them vanishes
+
+	Each reduced row is a combination of the equations with polynomial coefficients, divided by the contents removed along the way. Where the contents do not vanish, the specialized reduced rows are therefore in the span of the specialized equations, and where the coefficients of the pivots do not vanish, they are linearly independent.
+	@return The coefficients of the pivots that are not numeric, followed by the nonconstant contents
+*/
+	GiNaC::exvector degeneracy_conditions() const {
+		GiNaC::exvector result;
+		for (auto& pivot: pivots) {
+			auto p=coefficient(pivot.second,pivot.first);
+			if (!is_numeric(p)) result.push_back(p);
+		}
+		result.insert(result.end(),contents.begin(),contents.end());
+		return result;
+	}
+/** Return the value of each pivot unknown as an affine function of the free unknowns
+	@param unknowns The unknowns, corresponding to the first columns-1 columns
+	@return A list of relations unknown==value, one for each pivot column
+*/
+	GiNaC::lst solution(const GiNaC::exvector& unknowns) const {
+		GiNaC::lst result;
+		for (auto& pivot: pivots) {
+			GiNaC::ex p=coefficient(pivot.second,pivot.first), value;
+			for (auto& entry: pivot.second) {
+				if (entry.first==pivot.first) continue;
+				value-=entry.first==columns-1? entry.second : entry.second*unknowns[entry.first];
+			}
+			result.append(unknowns[pivot.first]==(is_numeric(p)? (value/p).expand() : (value/p).normal()));
+		}
+		return result;
+	}
+/** Return a basis of the solutions of the homogeneous system obtained by ignoring the constant terms
+	@return the solutions obtained by setting one free unknown equal to one and the others to zero, in increasing order of the free unknown, as sparse vectors
+*/
+	std::vector<std::map<int,GiNaC::ex>> kernel() const {
+		std::vector<std::map<int,GiNaC::ex>> result;
+		for (int free=0;free<columns-1;++free) {
+			if (pivots.count(free)) continue;
+			std::map<int,GiNaC::ex> solution;
+			solution[free]=1;
+			for (auto& pivot: pivots) {
+				GiNaC::ex a=coefficient(pivot.second,free);
+				if (a.is_zero()) continue;
+				GiNaC::ex p=coefficient(pivot.second,pivot.first);
+				solution[pivot.first]=is_numeric(p)? (-a/p).expand() : (-a/p).normal();
+			}
+			result.push_back(std::move(solution));
+		}
+		return result;
+	}
+};
+
+/** Solve a linear system in the given unknowns by fraction-free elimination; this is a replacement for lsolve, @sa PolynomialLinearSystem
+	@param equations A list of equations, or of expressions to be equated to zero, which are affine in the unknowns
+	@param unknowns A list of symbols
+	@return An empty list if the system has no solution, otherwise a list of relations x==value, one for each unknown in the given order, where value is x itself if x is free
+*/
+inline GiNaC::lst fraction_free_lsolve(const GiNaC::lst& equations, const GiNaC::lst& unknowns) {
+	GiNaC::exvector x{unknowns.begin(),unknowns.end()};
+	std::map<GiNaC::ex,int,GiNaC::ex_is_less> index;
+	for (int i=0;i<x.size();++i) index[x[i]]=i;
+	auto column_of=[&index,&x] (const GiNaC::ex& term) -> int {		//the index of the unknown appearing in a term of a linear expression, or the constant column
+		auto i=index.find(term);
+		if (i!=index.end()) return i->second;
+		if (GiNaC::is_a<GiNaC::mul>(term))
+			for (auto factor: term) 
+				if ((i=index.find(factor))!=index.end()) return i->second;
+		return x.size();
+	};
+	PolynomialLinearSystem system(x.size()+1);
+	for (auto eq: equations) {
+		GiNaC::ex e=(GiNaC::is_a<GiNaC::relational>(eq)? eq.lhs()-eq.rhs() : eq).expand();
+		std::map<int,GiNaC::ex> coefficients;
+		for (auto& term: GiNaC::is_a<GiNaC::add>(e)? GiNaC::exvector(e.begin(),e.end()) : GiNaC::exvector{e}) {
+			int column=column_of(term);
+			coefficients[column]+=column==x.size()? term : term.coeff(x[column]);
+		}
+		PolynomialRow row;
+		for (auto& entry: coefficients) {
+			GiNaC::ex c=entry.second.expand();
+			if (!c.is_zero()) row.emplace_back(entry.first,c);
+		}
+		system.add_row(std::move(row));
+		if (!system.is_consistent()) return {};
+	}
+	GiNaC::exmap values;
+	for (auto relation: system.solution(x)) values[relation.lhs()]=relation.rhs();
+	GiNaC::lst result;
+	for (auto& unknown: x) {
+		auto i=values.find(unknown);
+		result.append(unknown==(i==values.end()? unknown : i->second));
+	}
+	return result;
+}
+
+#endif
@@ -0,0 +1,243 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <string>
+#include <map>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <optional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdio>
+#include <unistd.h>
+#include "batch.h"
+#include "telemetry.h"
+
+/** The largest value of a measurement over the entries of a run, together with the entry where it was attained */
+struct Maximum {
+	double value=0;
+	std::string entry;
+	void update(double value, const std::string& entry) {
+		if (value<=this->value) return;
+		this->value=value;
+		this->entry=entry;
+	}
+};
+
+/** The progress of a run, reported periodically to a metrics file in the Prometheus text format and to a progress line on standard error
+
+	Entries are reported as started and finished by the OrderedProcessPool running them, or by the caller when entries are studied in-process; the telemetry of each entry is added as soon as its result reaches the parent. All methods may be invoked from different threads.
+*/
+class Progress : public PoolMonitor {
+	using Clock=std::chrono::steady_clock;
+	std::function<std::string(int)> name;
+	std::optional<int> total;
+	std::string metrics;
+	bool line;
+	bool terminal=isatty(STDERR_FILENO);
+	std::chrono::milliseconds interval;
+	Clock::time_point start=Clock::now(), last_report=start;
+	std::map<int,Clock::time_point> in_flight;
+	std::map<TaskStatus,long> finished_by_status;
+	long finished_entries=0;
+	std::map<std::string,double> stage_seconds;
+	std::map<std::string,Maximum> slowest_stage;
+	Maximum peak_rss, expression_nodes;
+	long total_expression_nodes=0;
+	mutable std::recursive_mutex mutex;
+
+	static std::string label(const std::string& value) {
+		std::string result;
+		for (char c: value)
+			if (c=='\\' || c=='"') result+={'\\',c};
+			else if (c=='\n') result+="\\n";
+			else result+=c;
+		return '"'+result+'"';
+	}
+	static std::string duration(double seconds) {
+		long s=seconds;
+		std::stringstream result;
+		result<<s/3600<<':'<<std::setfill('0')<<std::setw(2)<<s/60%60<<':'<<std::setw(2)<<s%60;
+		return result.str();
+	}
+	double elapsed() const {return std::chrono::duration<double>(Clock::now()-start).count();}
+	double throughput() const {
+		auto seconds=elapsed();
+		return seconds>0? finished_entries/seconds : 0;
+	}
+	std::optional<double> eta() const {
+		if (!total || !finished_entries) return std::nullopt;
+		return std::max(*total-finished_entries,0L)/throughput();
+	}
+	void write_metrics() const {
+		std::stringstream s;
+		s<<"# HELP gleipnir_elapsed_seconds Wall-clock time since the start of the run\n";
+		s<<"# TYPE gleipnir_elapsed_seconds gauge\n";
+		s<<"gleipnir_elapsed_seconds "<<elapsed()<<'\n';
+		if (total) {
+			s<<"# HELP gleipnir_entries Entries to be studied by the run\n";
+			s<<"# TYPE gleipnir_entries gauge\n";
+			s<<"gleipnir_entries "<<*total<<'\n';
+		}
+		s<<"# HELP gleipnir_entries_finished_total Entries finished, by outcome\n";
+		s<<"# TYPE gleipnir_entries_finished_total counter\n";
+		for (auto status: {TaskStatus::completed,TaskStatus::timed_out,TaskStatus::out_of_memory,TaskStatus::failed}) {
+			auto i=finished_by_status.find(status);
+			s<<"gleipnir_entries_finished_total{status="<<label(to_string(status))<<"} "<<(i==finished_by_status.end()? 0 : i->second)<<'\n';
+		}
+		s<<"# HELP gleipnir_throughput_entries_per_second Entries finished per second since the start of the run\n";
+		s<<"# TYPE gleipnir_throughput_entries_per_second gauge\n";
+		s<<"gleipnir_throughput_entries_per_second "<<throughput()<<'\n';
+		if (auto seconds=eta()) {
+			s<<"# HELP gleipnir_eta_seconds Estimated time to the end of the run, at the current throughput\n";
+			s<<"# TYPE gleipnir_eta_seconds gauge\n";
+			s<<"gleipnir_eta_seconds "<<*seconds<<'\n';
+		}
+		s<<"# HELP gleipnir_in_flight_seconds Wall-clock time spent so far on each entry being studied\n";
+		s<<"# TYPE gleipnir_in_flight_seconds gauge\n";
+		for (auto& entry: in_flight)
+			s<<"gleipnir_in_flight_seconds{entry="<<label(name(entry.first))<<"} "<<std::chrono::duration<double>(Clock::now()-entry.second).count()<<'\n';
+		s<<"# HELP gleipnir_stage_seconds_total Wall-clock time spent in each stage, over the completed entries\n";
+		s<<"# TYPE gleipnir_stage_seconds_total counter\n";
+		for (auto& stage: stage_seconds)
+			s<<"gleipnir_stage_seconds_total{stage="<<label(stage.first)<<"} "<<stage.second<<'\n';
+		s<<"# HELP gleipnir_stage_seconds_max Longest time spent in each stage by a single entry\n";
+		s<<"# TYPE gleipnir_stage_seconds_max gauge\n";
+		for (auto& stage: slowest_stage)
+			s<<"gleipnir_stage_seconds_max{stage="<<label(stage.first)<<",entry="<<label(stage.second.entry)<<"} "<<stage.second.value<<'\n';
+		s<<"# HELP gleipnir_peak_rss_kilobytes_max Largest peak resident set size of the process studying an entry\n";
+		s<<"# TYPE gleipnir_peak_rss_kilobytes_max gauge\n";
+		s<<"gleipnir_peak_rss_kilobytes_max{entry="<<label(peak_rss.entry)<<"} "<<peak_rss.value<<'\n';
+		s<<"# HELP gleipnir_expression_nodes_total Nodes in the symbolic expressions of the results of the completed entries\n";
+		s<<"# TYPE gleipnir_expression_nodes_total counter\n";
+		s<<"gleipnir_expression_nodes_total "<<total_expression_nodes<<'\n';
+		s<<"# HELP gleipnir_expression_nodes_max Largest number of nodes in the symbolic expressions of the results of an entry\n";
+		s<<"# TYPE gleipnir_expression_nodes_max gauge\n";
+		s<<"gleipnir_expression_nodes_max{entry="<<label(expression_nodes.entry)<<"} "<<expression_nodes.value<<'\n';
+		auto temporary=metrics+".tmp";
+		{
+			std::ofstream file{temporary};
+			if (!(file<<s.str()<<std::flush)) return;		//monitoring must not interrupt the run
+		}
+		std::rename(temporary.c_str(),metrics.c_str());
+	}
+	void write_line() const {
+		std::stringstream s;
+		s<<finished_entries;
+		if (total) s<<'/'<<*total;
+		s<<" done";
+		auto failures=finished_entries-(finished_by_status.count(TaskStatus::completed)? finished_by_status.at(TaskStatus::completed) : 0);
+		if (failures) s<<", "<<failures<<" failed";
+		s<<", "<<std::fixed<<std::setprecision(2)<<throughput()<<"/s";
+		if (auto seconds=eta()) s<<", ETA "<<duration(*seconds);
+		if (!in_flight.empty()) {
+			auto oldest=std::min_element(in_flight.begin(),in_flight.end(),[] (auto& x, auto& y) {return x.second<y.second;});
+			s<<", "<<in_flight.size()<<" running, longest "<<name(oldest->first)<<" ("<<duration(std::chrono::duration<double>(Clock::now()-oldest->second).count())<<")";
+		}
+		if (terminal) std::cerr<<'\r'<<s.str()<<"\33[K"<<std::flush;
+		else std::cerr<<s.str()<<std::endl;
+	}
+	void report() {
+		if (!metrics.empty()) write_metrics();
+		if (line) write_line();
+		last_report=Clock::now();
+	}
+public:
+/** Create an object reporting the progress of a run
+	@param name A function returning the name of an entry given its index
+	@param total The number of entries to be studied, if known in advance
+	@param metrics The file where the metrics are written, replacing it atomically at each report; if empty, no metrics are written
+	@param line If true, a progress line is written on standard error at each report
+	@param interval The minimum interval between consecutive reports
+*/
+	Progress(std::function<std::string(int)> name, std::optional<int> total, std::string metrics, bool line, std::chrono::milliseconds interval=std::chrono::seconds(1)) :
+		name{move(name)}, total{total}, metrics{move(metrics)}, line{line}, interval{interval} {}
+	~Progress() {
+		std::lock_guard<std::recursive_mutex> lock{mutex};
+		report();
+		if (line && terminal) std::cerr<<std::endl;
+	}
+	std::chrono::milliseconds report_interval() const {return interval;}
+	void started(int index) override {
+		std::lock_guard<std::recursive_mutex> lock{mutex};
+		in_flight[index]=Clock::now();
+	}
+	void finished(int index, TaskStatus status) override {
+		std::lock_guard<std::recursive_mutex> lock{mutex};
+		in_flight.erase(index);
+		++finished_by_status[status];
+		++finished_entries;
+	}
+/** Change the number of entries to be studied, if known, as entries turn out not to need studying or to need studying again */
+	void adjust_total(int change) {
+		std::lock_guard<std::recursive_mutex> lock{mutex};
+		if (total) *total+=change;
+	}
+/** Add the telemetry of an entry that completed */
+	void add(int index, const StudyTelemetry& telemetry) {
+		std::lock_guard<std::recursive_mutex> lock{mutex};
+		auto entry=name(index);
+		for (auto& stage: telemetry.stage_seconds) {
+			stage_seconds[stage.first]+=stage.second;
+			slowest_stage[stage.first].update(stage.second,entry);
+		}
+		peak_rss.update(telemetry.peak_rss_kilobytes,entry);
+		expression_nodes.update(telemetry.expression_nodes,entry);
+		total_expression_nodes+=telemetry.expression_nodes;
+	}
+/** Report the progress, unless the last report is more recent than the interval */
+	void tick() override {
+		std::lock_guard<std::recursive_mutex> lock{mutex};
+		if (Clock::now()-last_report>=interval) report();
+	}
+};
+
+/** A thread invoking Progress::tick periodically, for runs where entries are studied in-process, so that an entry taking long is visible while it runs
+
+	Must not be alive when the process forks.
+*/
+class ProgressTicker {
+	Progress& progress;
+	std::mutex mutex;
+	std::condition_variable stopped;
+	bool stop=false;
+	std::thread thread;
+public:
+	explicit ProgressTicker(Progress& progress) : progress{progress}, thread{[this] () {
+		std::unique_lock<std::mutex> lock{mutex};
+		while (!stopped.wait_for(lock,this->progress.report_interval(),[this] () {return stop;}))
+			this->progress.tick();
+	}} {}
+	~ProgressTicker() {
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			stop=true;
+		}
+		stopped.notify_one();
+		thread.join();
+	}
+};
+
+#endif
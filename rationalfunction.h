@@ -0,0 +1,134 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RATIONALFUNCTION_H
+#define RATIONALFUNCTION_H
+
+#include <gmpxx.h>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+/** A polynomial in one variable with rational coefficients, stored as the vector of its coefficients in increasing degree, with no trailing zeros */
+using RationalPolynomial = std::vector<mpq_class>;
+
+/** A rational function in one variable, as a pair (numerator, denominator) */
+struct RationalFunction {
+	RationalPolynomial numerator;
+	RationalPolynomial denominator;
+};
+
+inline void trim(RationalPolynomial& p) {
+	while (!p.empty() && p.back()==0) p.pop_back();
+}
+
+/** The degree of a polynomial, with the convention that the zero polynomial has degree -1 */
+inline int degree(const RationalPolynomial& p) {return static_cast<int>(p.size())-1;}
+
+inline mpq_class evaluate(const RationalPolynomial& p, const mpq_class& x) {
+	mpq_class result=0;
+	for (auto i=p.rbegin();i!=p.rend();++i) result=result*x+*i;
+	return result;
+}
+
+inline RationalPolynomial operator+(const RationalPolynomial& p, const RationalPolynomial& q) {
+	RationalPolynomial result(std::max(p.size(),q.size()));
+	for (int i=0;i<p.size();++i) result[i]+=p[i];
+	for (int i=0;i<q.size();++i) result[i]+=q[i];
+	trim(result);
+	return result;
+}
+
+inline RationalPolynomial operator-(const RationalPolynomial& p, const RationalPolynomial& q) {
+	RationalPolynomial result(std::max(p.size(),q.size()));
+	for (int i=0;i<p.size();++i) result[i]+=p[i];
+	for (int i=0;i<q.size();++i) result[i]-=q[i];
+	trim(result);
+	return result;
+}
+
+inline RationalPolynomial operator*(const RationalPolynomial& p, const RationalPolynomial& q) {
+	if (p.empty() || q.empty()) return {};
+	RationalPolynomial result(p.size()+q.size()-1);
+	for (int i=0;i<p.size();++i)
+		for (int j=0;j<q.size();++j)
+			result[i+j]+=p[i]*q[j];
+	trim(result);
+	return result;
+}
+
+/** Divide p by a nonzero polynomial q
+	@return The pair (quotient, remainder)
+*/
+inline std::pair<RationalPolynomial,RationalPolynomial> divide(RationalPolynomial p, const RationalPolynomial& q) {
+	RationalPolynomial quotient(std::max(degree(p)-degree(q)+1,0));
+	while (degree(p)>=degree(q)) {
+		int shift=degree(p)-degree(q);
+		mpq_class factor=p.back()/q.back();
+		quotient[shift]=factor;
+		for (int i=0;i<q.size();++i) p[i+shift]-=factor*q[i];
+		trim(p);
+	}
+	trim(quotient);
+	return {quotient,p};
+}
+
+/** Return the polynomial of degree less than the number of points taking the given values */
+inline RationalPolynomial interpolate(const std::vector<mpq_class>& points, const std::vector<mpq_class>& values) {
+	RationalPolynomial result, basis{1};		//basis is the product of x-points[j] for j<i
+	for (int i=0;i<points.size();++i) {
+		mpq_class coefficient=(values[i]-evaluate(result,points[i]))/evaluate(basis,points[i]);
+		RationalPolynomial term(basis.size());
+		for (int j=0;j<basis.size();++j) term[j]=coefficient*basis[j];
+		result=result+term;
+		basis=basis*RationalPolynomial{-points[i],1};
+	}
+	return result;
+}
+
+/** Find a rational function with numerator and denominator of degree less than half the number of points taking the given values
+	@param points Distinct rational numbers
+	@param values The values at the points
+	@return The rational function, with monic denominator, or nothing if none exists
+
+	This is the polynomial analogue of rational reconstruction: the extended Euclidean algorithm is applied to the interpolating polynomial and the product of x-x_i, stopping at the first remainder of degree less than half the number of points.
+*/
+inline std::optional<RationalFunction> rational_function_reconstruction(const std::vector<mpq_class>& points, const std::vector<mpq_class>& values) {
+	int bound=points.size()/2;
+	RationalPolynomial r0{1}, r1=interpolate(points,values), t0, t1{1};
+	for (auto& x: points) r0=r0*RationalPolynomial{-x,1};
+	while (degree(r1)>=bound) {
+		auto division=divide(r0,r1);
+		r0=std::move(r1); r1=std::move(division.second);
+		auto t=t0-division.first*t1;
+		t0=std::move(t1); t1=std::move(t);
+	}
+	if (t1.empty() || degree(t1)>=static_cast<int>(points.size())-bound) return std::nullopt;
+	for (int i=0;i<points.size();++i)
+		if (evaluate(t1,points[i])==0 || evaluate(r1,points[i])!=values[i]*evaluate(t1,points[i])) return std::nullopt;
+	mpq_class leading=t1.back();
+	for (auto& c: r1) c/=leading;
+	for (auto& c: t1) c/=leading;
+	return RationalFunction{r1,t1};
+}
+
+inline mpq_class evaluate(const RationalFunction& f, const mpq_class& x) {
+	return evaluate(f.numerator,x)/evaluate(f.denominator,x);
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <iostream>
+
+/** The results of studying a Lie algebra, in textual form */
+struct StudyRecord {
+	std::string structure_constants;	///< the normal form of the structure constants, @sa StructureConstants::normal_form
+	std::string derivations;		///< the generic derivation, as a matrix
+	std::string derivation_basis;		///< a basis of the space of derivations, as matrices, one per line
+	std::string nikolayevsky;		///< the candidate Nikolayevsky derivation N, as a matrix
+	std::string derivation_when;		///< the conditions for N to be a derivation
+	std::string trace_form;		///< the Gram matrix of the trace form tr(XY) on the space of derivations, from which N is computed
+	std::string eigenvalues;		///< the eigenvalues of N, one per line, if N has been determined and is diagonalizable
+	std::string centralizer;		///< the generic element of a space containing the centralizer of N, as a matrix
+	std::string centralizer_dimension;		///< the dimension of the space containing the centralizer of N
+	std::string output;		///< the text printed by study_group
+};
+
+/** Return the fields of a record together with their names, in a fixed order */
+inline std::vector<std::pair<const char*, std::string*>> fields(StudyRecord& record) {
+	return {
+		{"structure_constants",&record.structure_constants},
+		{"derivations",&record.derivations},
+		{"derivation_basis",&record.derivation_basis},
+		{"nikolayevsky",&record.nikolayevsky},
+		{"derivation_when",&record.derivation_when},
+		{"trace_form",&record.trace_form},
+		{"eigenvalues",&record.eigenvalues},
+		{"centralizer",&record.centralizer},
+		{"centralizer_dimension",&record.centralizer_dimension},
+		{"output",&record.output}
+	};
+}
+
+/** @overload */
+inline std::vector<std::pair<const char*, const std::string*>> fields(const StudyRecord& record) {
+	return {
+		{"structure_constants",&record.structure_constants},
+		{"derivations",&record.derivations},
+		{"derivation_basis",&record.derivation_basis},
+		{"nikolayevsky",&record.nikolayevsky},
+		{"derivation_when",&record.derivation_when},
+		{"trace_form",&record.trace_form},
+		{"eigenvalues",&record.eigenvalues},
+		{"centralizer",&record.centralizer},
+		{"centralizer_dimension",&record.centralizer_dimension},
+		{"output",&record.output}
+	};
+}
+
+/** Write a record to a stream; each field is written as a line containing its name and length, followed by its content and a newline */
+inline void write(std::ostream& os, const StudyRecord& record) {
+	for (auto& field: fields(record))
+		os<<field.first<<' '<<field.second->size()<<'\n'<<*field.second<<'\n';
+}
+
+/** Read a record written by write
+	@return true if a complete record was read
+*/
+inline bool read(std::istream& is, StudyRecord& record) {
+	for (auto& field: fields(record)) {
+		std::string name;
+		size_t size;
+		if (!(is>>name>>size) || name!=field.first || is.get()!='\n') return false;
+		field.second->resize(size);
+		if (!is.read(&(*field.second)[0],size) || is.get()!='\n') return false;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,351 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <optional>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "batch.h"
+
+/** The latency of a stage of the processing of requests, in milliseconds */
+class Latency {
+	long count=0;
+	double total=0, maximum=0;
+public:
+	void add(std::chrono::steady_clock::duration duration) {
+		double milliseconds=std::chrono::duration<double,std::milli>(duration).count();
+		++count;
+		total+=milliseconds;
+		maximum=std::max(maximum,milliseconds);
+	}
+/** Return the mean and the maximum as a JSON object */
+	std::string json() const {
+		return "{\"mean\":"+std::to_string(count? total/count : 0)+",\"max\":"+std::to_string(maximum)+"}";
+	}
+};
+
+/** The answers to the requests seen by a server, kept for repeated requests within a memory budget
+
+	When the total size of the requests and answers exceeds the budget, the least recently used ones are discarded, so that a server running for a long time does not grow without limit.
+*/
+class AnswerCache {
+	using Entry=std::pair<std::string,std::string>;
+	size_t capacity, size=0;
+	std::list<Entry> entries;		///< requests and answers, the most recently used first
+	std::unordered_map<std::string,std::list<Entry>::iterator> index;
+	static size_t size_of(const Entry& entry) {return entry.first.size()+entry.second.size();}
+public:
+/** @param capacity The budget, in bytes */
+	explicit AnswerCache(size_t capacity) : capacity{capacity} {}
+/** Return the answer to a request, if known, marking it as recently used */
+	std::optional<std::string> find(const std::string& request) {
+		auto i=index.find(request);
+		if (i==index.end()) return std::nullopt;
+		entries.splice(entries.begin(),entries,i->second);
+		return i->second->second;
+	}
+/** Record the answer to a request, discarding the least recently used answers if needed */
+	void insert(const std::string& request, const std::string& answer) {
+		if (auto i=index.find(request);i!=index.end()) {
+			size-=size_of(*i->second);
+			entries.erase(i->second);
+			index.erase(i);
+		}
+		entries.emplace_front(request,answer);
+		index.emplace(request,entries.begin());
+		size+=size_of(entries.front());
+		while (size>capacity) {
+			size-=size_of(entries.back());
+			index.erase(entries.back().first);
+			entries.pop_back();
+		}
+	}
+};
+
+/** A server reading requests from a Unix socket, one per line, and answering each with one line, in the order of the requests of each client
+
+	Requests are studied in child processes forked from the server, at most a fixed number at a time, and subject to resource limits as in OrderedProcessPool; anything built in the server before forking, such as GL(n,R) for the dimensions seen so far, is shared with the children and kept for later requests. Clients may send many requests without waiting for the answers, so that a batch costs a single round-trip. The request STATS is answered with a JSON object containing the number of queued and running requests and the latency of each stage, taken when the request is received; like any other answer, it is sent after the answers to the earlier requests of the same client, so a busy server is best monitored through a separate connection. The queued requests of a client that disconnects are dropped. The server runs until it receives SIGINT or SIGTERM.
+*/
+class Server {
+	using Clock=std::chrono::steady_clock;
+	struct Request {
+		std::string line;
+		Clock::time_point received, started;
+		bool answered=false;
+		bool abandoned=false;		///< true if the client went away before the answer was sent
+		std::string answer;
+	};
+	struct Client {
+		int fd;
+		std::string input, output;
+		std::deque<std::shared_ptr<Request>> pending;		///< requests in the order they were received, including answered ones that wait for an earlier one
+		bool end_of_input=false;
+	};
+	struct Worker {
+		pid_t pid;
+		int fd;
+		std::shared_ptr<Request> request;
+		Clock::time_point deadline;
+		bool killed;
+		std::string output;
+	};
+	std::string path;
+	int listening;
+	int jobs;
+	ResourceLimits limits;
+	std::function<std::optional<std::string>(const std::string&)> lookup;
+	std::function<void(const std::string&)> prepare;
+	std::function<std::string(const std::string&)> task;
+	std::function<std::string(const std::string&,TaskStatus,const std::string&)> answer;
+	std::vector<Client> clients;
+	std::deque<std::shared_ptr<Request>> queue;
+	std::vector<Worker> workers;
+	long requests=0, completed=0, failed=0, answered_without_workers=0;
+	Latency queue_latency, study_latency, total_latency;
+	static inline volatile sig_atomic_t stop=0;
+
+	static void request_stop(int) {stop=1;}
+	std::string statistics() const {
+		return "{\"queue\":"+std::to_string(queue.size())
+			+",\"running\":"+std::to_string(workers.size())
+			+",\"clients\":"+std::to_string(clients.size())
+			+",\"requests\":"+std::to_string(requests)
+			+",\"completed\":"+std::to_string(completed)
+			+",\"failed\":"+std::to_string(failed)
+			+",\"answered_without_workers\":"+std::to_string(answered_without_workers)
+			+",\"latency_ms\":{\"queue\":"+queue_latency.json()+",\"study\":"+study_latency.json()+",\"total\":"+total_latency.json()+"}}\n";
+	}
+	void finish(Request& request, std::string answer) {
+		request.answered=true;
+		request.answer=std::move(answer);
+		total_latency.add(Clock::now()-request.received);
+	}
+	void receive(Client& client, std::string line) {
+		line.erase(0,line.find_first_not_of(" \t"));
+		line.erase(line.find_last_not_of(" \t\r")+1);
+		if (line.empty() || line[0]=='#') return;
+		auto request=std::make_shared<Request>();
+		request->line=line;
+		request->received=Clock::now();
+		client.pending.push_back(request);
+		if (line=="STATS") {
+			request->answered=true;
+			request->answer=statistics();
+			return;
+		}
+		++requests;
+		if (auto known=lookup(line)) {
+			++answered_without_workers;
+			finish(*request,*known);
+		}
+		else queue.push_back(request);
+	}
+	void read_from(Client& client) {
+		char buffer[65536];
+		auto bytes=read(client.fd,buffer,sizeof(buffer));
+		if (bytes<0 && (errno==EINTR || errno==EAGAIN)) return;
+		if (bytes<=0) {
+			client.end_of_input=true;
+			if (!client.input.empty()) receive(client,move(client.input));
+			return;
+		}
+		client.input.append(buffer,bytes);
+		size_t begin=0;
+		for (auto end=client.input.find('\n');end!=std::string::npos;end=client.input.find('\n',begin)) {
+			receive(client,client.input.substr(begin,end-begin));
+			begin=end+1;
+		}
+		client.input.erase(0,begin);
+	}
+	void collect_answers(Client& client) {
+		while (!client.pending.empty() && client.pending.front()->answered) {
+			client.output+=client.pending.front()->answer;
+			client.pending.pop_front();
+		}
+	}
+/** Forget the requests of a client that went away, removing those not started yet from the queue */
+	void disconnect(Client& client) {
+		for (auto& request: client.pending) request->abandoned=true;
+		queue.erase(remove_if(queue.begin(),queue.end(),[] (auto& request) {return request->abandoned;}),queue.end());
+		client.output.clear();
+		client.pending.clear();
+		client.end_of_input=true;
+	}
+	void write_to(Client& client) {
+		auto bytes=write(client.fd,client.output.data(),client.output.size());
+		if (bytes>0) client.output.erase(0,bytes);
+		else if (bytes<0 && errno!=EINTR && errno!=EAGAIN) disconnect(client);
+	}
+	void spawn(std::shared_ptr<Request> request) {
+		try {prepare(request->line);}
+		catch (const std::exception&) {}		//the error is reported by the worker
+		int fds[2];
+		if (pipe(fds)) throw std::runtime_error("cannot create pipe");
+		std::cout.flush(); std::cerr.flush();
+		pid_t pid=fork();
+		if (pid<0) throw std::runtime_error("cannot fork");
+		if (!pid) {
+			close(fds[0]);
+			close(listening);
+			for (auto& client: clients) close(client.fd);
+			apply_memory_limit(limits);
+			int status=0;
+			try {write_all(fds[1],task(request->line));}
+			catch (const std::bad_alloc&) {status=exit_out_of_memory;}
+			catch (const std::exception& e) {
+				write_all(fds[1],e.what());
+				status=1;
+			}
+			close(fds[1]);
+			_exit(status);
+		}
+		close(fds[1]);
+		request->started=Clock::now();
+		queue_latency.add(request->started-request->received);
+		auto deadline=limits.timeout_seconds? request->started+std::chrono::seconds(limits.timeout_seconds) : Clock::time_point::max();
+		workers.push_back(Worker{pid,fds[0],move(request),deadline,false,{}});
+	}
+	void read_from(Worker& worker, bool& done) {
+		char buffer[65536];
+		auto bytes=read(worker.fd,buffer,sizeof(buffer));
+		if (bytes>0) {worker.output.append(buffer,bytes); return;}
+		if (bytes<0 && errno==EINTR) return;
+		close(worker.fd);
+		int status=0;
+		while (waitpid(worker.pid,&status,0)<0 && errno==EINTR);
+		auto outcome=task_status(status,worker.killed);
+		if (outcome==TaskStatus::completed) ++completed;
+		else ++failed;
+		study_latency.add(Clock::now()-worker.request->started);
+		finish(*worker.request,answer(worker.request->line,outcome,worker.output));
+		done=true;
+	}
+	int milliseconds_to_next_deadline() const {
+		auto deadline=Clock::time_point::max();
+		for (auto& worker: workers)
+			if (!worker.killed && worker.deadline<deadline) deadline=worker.deadline;
+		if (deadline==Clock::time_point::max()) return -1;
+		auto left=std::chrono::duration_cast<std::chrono::milliseconds>(deadline-Clock::now()).count();
+		return left>0? left+1 : 0;
+	}
+	void kill_expired() {
+		auto now=Clock::now();
+		for (auto& worker: workers)
+			if (!worker.killed && worker.deadline<=now) {
+				kill(worker.pid,SIGKILL);
+				worker.killed=true;
+			}
+	}
+	void accept_client() {
+		int fd=accept(listening,nullptr,nullptr);
+		if (fd<0) return;
+		fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)|O_NONBLOCK);
+		clients.push_back(Client{fd,{},{},{},false});
+	}
+public:
+/** Create a server listening on a Unix socket
+	@param path The path of the socket, which is replaced if it exists
+	@param jobs The maximum number of requests studied at the same time
+	@param limits The resource limits of each request
+	@param lookup A function returning the answer to a request if it is known without studying it, invoked in the server
+	@param prepare A function invoked in the server before forking a child to study a request, to build data that later requests can share
+	@param task A function studying a request, invoked in a child process; its return value is passed to answer
+	@param answer A function returning the answer to a request, terminated by a newline, from the outcome of the task and its output, invoked in the server; if the task threw an exception, the output is the message
+	@exception std::runtime_error if the socket cannot be created
+*/
+	Server(const std::string& path, int jobs, ResourceLimits limits, decltype(lookup) lookup, decltype(prepare) prepare, decltype(task) task, decltype(answer) answer) :
+		path{path}, jobs{jobs}, limits{limits}, lookup{move(lookup)}, prepare{move(prepare)}, task{move(task)}, answer{move(answer)} {
+		sockaddr_un address{};
+		address.sun_family=AF_UNIX;
+		if (path.size()>=sizeof(address.sun_path)) throw std::runtime_error("socket path too long: "+path);
+		path.copy(address.sun_path,path.size());
+		listening=socket(AF_UNIX,SOCK_STREAM,0);
+		if (listening<0) throw std::runtime_error("cannot create socket");
+		unlink(path.c_str());
+		if (bind(listening,reinterpret_cast<sockaddr*>(&address),sizeof(address)) || listen(listening,SOMAXCONN)) {
+			close(listening);
+			throw std::runtime_error("cannot listen on "+path);
+		}
+	}
+	Server(const Server&)=delete;
+	~Server() {
+		for (auto& worker: workers) {
+			kill(worker.pid,SIGKILL);
+			close(worker.fd);
+			while (waitpid(worker.pid,nullptr,0)<0 && errno==EINTR);
+		}
+		for (auto& client: clients) close(client.fd);
+		close(listening);
+		unlink(path.c_str());
+	}
+/** Serve requests until SIGINT or SIGTERM is received */
+	void run() {
+		signal(SIGPIPE,SIG_IGN);
+		signal(SIGINT,request_stop);
+		signal(SIGTERM,request_stop);
+		while (!stop) {
+			while (workers.size()<jobs && !queue.empty()) {
+				spawn(queue.front());
+				queue.pop_front();
+			}
+			std::vector<pollfd> fds{pollfd{listening,POLLIN,0}};
+			for (auto& client: clients) {
+				collect_answers(client);
+				int fd=client.end_of_input && client.output.empty() && client.pending.empty()? -1 : client.fd;		//poll ignores negative descriptors, and reports POLLHUP for the others if the client goes away
+				fds.push_back(pollfd{fd,static_cast<short>((client.end_of_input? 0 : POLLIN) | (client.output.empty()? 0 : POLLOUT)),0});
+			}
+			for (auto& worker: workers) fds.push_back(pollfd{worker.fd,POLLIN,0});
+			if (poll(fds.data(),fds.size(),milliseconds_to_next_deadline())<0) {
+				if (errno==EINTR) continue;
+				throw std::runtime_error("poll failed");
+			}
+			kill_expired();
+			for (int i=workers.size()-1;i>=0;--i) {
+				if (!fds[1+clients.size()+i].revents) continue;
+				bool done=false;
+				read_from(workers[i],done);
+				if (done) workers.erase(workers.begin()+i);
+			}
+			for (int i=0;i<clients.size();++i) {
+				auto events=fds[1+i].revents;
+				if (!clients[i].end_of_input && (events & (POLLIN|POLLHUP|POLLERR))) read_from(clients[i]);
+				if (events & POLLOUT) write_to(clients[i]);
+				if (events & (POLLHUP|POLLERR)) disconnect(clients[i]);
+			}
+			clients.erase(remove_if(clients.begin(),clients.end(),[] (const Client& client) {
+				bool finished=client.end_of_input && client.pending.empty() && client.output.empty();
+				if (finished) close(client.fd);
+				return finished;
+			}),clients.end());
+			if (fds[0].revents & POLLIN) accept_client();
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+/** Return the dimension of a Lie algebra from its description, without constructing it
+	@param description A Lie algebra in the format accepted by lie_group_from_string, e.g. "0,0,12,13,[lambda]*14+23; lambda"
+	@return The number of differentials, i.e. of commas in the structure constants outside brackets and parentheses, plus one
+*/
+inline int described_dimension(std::string_view description) {
+	int dimension=1, level=0;
+	for (char c: description.substr(0,description.find(';')))
+		if (c=='(' || c=='[') ++level;
+		else if (c==')' || c==']') --level;
+		else if (c==',' && !level) ++dimension;
+	return dimension;
+}
+
+/** Estimate the relative cost of studying a Lie algebra from its description, without constructing it
+	@param description A Lie algebra in the format accepted by lie_group_from_string, e.g. "0,0,12,13,[lambda]*14+23; lambda"
+	@return A positive number, which is larger for Lie algebras that are expected to take longer
+
+	The estimate is (n+t)s, where n is the dimension, t the number of terms in the structure constants and s the length of the longest chain e^k, e^i, ... where each element appears in the differential of the previous one, which is the step for the bases used in the classifications; it is multiplied by 10 for each parameter, since the equations for Lie algebras with parameters are solved symbolically. Terms whose indices cannot be read are counted, but do not contribute to s.
+*/
+inline double estimated_cost(std::string_view description) {
+	auto semicolon=description.find(';');
+	auto structure_constants=description.substr(0,semicolon);
+	int parameters=0;
+	if (semicolon!=std::string_view::npos) {
+		bool in_name=false;
+		for (char c: description.substr(semicolon+1)) {
+			bool name_character=c!=',' && c!=' ' && c!='\t' && c!='\r';
+			if (name_character && !in_name) ++parameters;
+			in_name=name_character;
+		}
+	}
+	std::vector<std::string_view> differentials;
+	for (size_t begin=0;begin<=structure_constants.size();) {
+		auto end=std::min(structure_constants.find(',',begin),structure_constants.size());
+		differentials.push_back(structure_constants.substr(begin,end-begin));
+		begin=end+1;
+	}
+	auto index=[&differentials] (char c) {
+		int i=c>='0' && c<='9'? c-'0' : c>='a' && c<='z'? c-'a'+10 : c>='A' && c<='Z'? c-'A'+10 : 0;
+		return i>=1 && i<=differentials.size()? i-1 : -1;
+	};
+	int terms=0;
+	std::vector<int> depth(differentials.size(),1);
+	for (int k=0;k<differentials.size();++k) {
+		auto differential=differentials[k];
+		if (differential.find_first_not_of("0 ")==std::string_view::npos) continue;
+		size_t begin=0;
+		int level=0;		//nesting of brackets and parentheses
+		for (size_t i=0;i<=differential.size();++i) {
+			char c=i<differential.size()? differential[i] : '+';
+			if (c=='(' || c=='[') ++level;
+			else if (c==')' || c==']') --level;
+			if (level || (c!='+' && c!='-')) continue;
+			auto term=differential.substr(begin,i-begin);
+			begin=i+1;
+			if (auto star=term.rfind('*');star!=std::string_view::npos) term=term.substr(star+1);
+			term=term.substr(0,term.find_last_not_of(" ")+1);
+			term=term.substr(std::min(term.find_first_not_of(" "),term.size()));
+			if (term.empty()) continue;
+			++terms;
+			if (term.size()!=2) continue;
+			int i1=index(term[0]), i2=index(term[1]);
+			if (i1>=0 && i1<k) depth[k]=std::max(depth[k],depth[i1]+1);
+			if (i2>=0 && i2<k) depth[k]=std::max(depth[k],depth[i2]+1);
+		}
+	}
+	double cost=(differentials.size()+terms)**std::max_element(depth.begin(),depth.end());
+	for (int i=0;i<parameters;++i) cost*=10;
+	return cost;
+}
+
+/** A part of a run divided among several nodes */
+struct Shard {
+	int index=1;		///< the one-based index of this part
+	int count=1;		///< the number of parts
+};
+
+/** Parse a shard specification
+	@param specification A string of the form i/N, with 1<=i<=N
+	@exception std::invalid_argument if the specification is not valid
+*/
+inline Shard parse_shard(const std::string& specification) {
+	Shard shard;
+	auto slash=specification.find('/');
+	size_t end_of_index=0, end_of_count=0;
+	try {
+		if (slash!=std::string::npos) {
+			shard.index=std::stoi(specification.substr(0,slash),&end_of_index);
+			shard.count=std::stoi(specification.substr(slash+1),&end_of_count);
+		}
+	}
+	catch (const std::exception&) {end_of_index=0;}
+	if (slash==std::string::npos || end_of_index!=slash || end_of_count!=specification.size()-slash-1 || shard.count<1 || shard.index<1 || shard.index>shard.count)
+		throw std::invalid_argument("--shard expects i/N with 1<=i<=N, got "+specification);
+	return shard;
+}
+
+/** Select the tasks assigned to a shard, balancing the estimated costs
+	@param costs The estimated cost of each task
+	@param shard The shard
+	@return The zero-based positions in costs of the tasks assigned to the shard, in increasing order
+
+	Tasks are taken in order of decreasing cost, breaking ties by position, and each is assigned to the shard with the least total cost so far, breaking ties by index. The result only depends on the costs, so that nodes running different shards of the same input agree on the partition without communicating.
+*/
+inline std::vector<int> shard_tasks(const std::vector<double>& costs, Shard shard) {
+	std::vector<int> order(costs.size());
+	std::iota(order.begin(),order.end(),0);
+	std::stable_sort(order.begin(),order.end(),[&costs] (int i, int j) {return costs[i]>costs[j];});
+	std::vector<double> load(shard.count);
+	std::vector<int> result;
+	for (int i: order) {
+		int least_loaded=std::min_element(load.begin(),load.end())-load.begin();
+		load[least_loaded]+=costs[i];
+		if (least_loaded==shard.index-1) result.push_back(i);
+	}
+	std::sort(result.begin(),result.end());
+	return result;
+}
+
+#endif
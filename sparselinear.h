@@ -0,0 +1,188 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARSELINEAR_H
+#define SPARSELINEAR_H
+
+#include <gmpxx.h>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <numeric>
+
+/** A sparse row with integer coefficients, stored as pairs (column, coefficient) in increasing order of column, with no zero coefficients */
+using IntegerRow = std::vector<std::pair<int,mpz_class>>;
+
+/** A sparse vector with rational coefficients, indexed by column */
+using RationalRow = std::map<int,mpq_class>;
+
+/** Divide a row by the gcd of its coefficients, and make the leading coefficient positive */
+inline void remove_content(IntegerRow& row) {
+	if (row.empty()) return;
+	mpz_class content=0;
+	for (auto& entry: row) {
+		content=gcd(content,entry.second);
+		if (content==1) break;
+	}
+	if (row.front().second<0) content=-content;
+	if (content!=1)
+		for (auto& entry: row) mpz_divexact(entry.second.get_mpz_t(),entry.second.get_mpz_t(),content.get_mpz_t());
+}
+
+/** Convert a rational row to a primitive integer row with positive leading coefficient */
+inline IntegerRow to_integer_row(const RationalRow& row) {
+	mpz_class denominator=1;
+	for (auto& entry: row)
+		if (entry.second!=0) denominator=lcm(denominator,entry.second.get_den());
+	IntegerRow result;
+	for (auto& entry: row)
+		if (entry.second!=0) result.emplace_back(entry.first,mpz_class{entry.second*denominator});
+	remove_content(result);
+	return result;
+}
+
+/** Return the coefficient of a row in a given column, or zero */
+inline mpz_class coefficient(const IntegerRow& row, int column) {
+	auto i=lower_bound(row.begin(),row.end(),column,[] (const std::pair<int,mpz_class>& entry, int column) {return entry.first<column;});
+	return i!=row.end() && i->first==column? i->second : mpz_class{0};
+}
+
+/** Eliminate a column from a row using a pivot row, without introducing fractions
+	@param row The row to be modified
+	@param pivot A row whose leading coefficient is in the given column
+	@param column The column to eliminate
+
+	The row is replaced by p*row-r*pivot, where p is the leading coefficient of pivot and r the coefficient of row in the given column, and then divided by its content.
+*/
+inline void eliminate(IntegerRow& row, const IntegerRow& pivot, int column) {
+	mpz_class r=coefficient(row,column);
+	if (r==0) return;
+	const mpz_class& p=pivot.front().second;
+	mpz_class g=gcd(p,r);
+	mpz_class row_factor=p/g, pivot_factor=r/g;
+	IntegerRow result;
+	result.reserve(row.size()+pivot.size());
+	auto i=row.cbegin(), j=pivot.cbegin();
+	while (i!=row.cend() || j!=pivot.cend()) {
+		mpz_class value;
+		int col;
+		if (j==pivot.cend() || (i!=row.cend() && i->first<j->first)) {col=i->first; value=row_factor*i->second; ++i;}
+		else if (i==row.cend() || j->first<i->first) {col=j->first; value=-pivot_factor*j->second; ++j;}
+		else {col=i->first; value=row_factor*i->second-pivot_factor*j->second; ++i; ++j;}
+		if (value!=0) result.emplace_back(col,std::move(value));
+	}
+	remove_content(result);
+	row=std::move(result);
+}
+
+/** A partition of the integers 0,...,size-1 into blocks, which can be merged; used to split linear systems into independent subsystems */
+class Blocks {
+	std::vector<int> parent;
+public:
+	explicit Blocks(int size) : parent(size) {std::iota(parent.begin(),parent.end(),0);}
+	int size() const {return parent.size();}
+/** Return a representative of the block containing x */
+	int block(int x) {
+		while (parent[x]!=x) x=parent[x]=parent[parent[x]];
+		return x;
+	}
+	void merge(int x, int y) {parent[block(x)]=block(y);}
+};
+
+/** A list of homogeneous linear equations with integer coefficients in a fixed number of unknowns */
+struct IntegerEquations {
+	int columns;
+	std::vector<IntegerRow> rows;
+};
+
+/** Return true if a vector with rational coefficients satisfies a list of equations exactly */
+inline bool satisfies(const IntegerEquations& equations, const RationalRow& x) {
+	for (auto& row: equations.rows) {
+		mpq_class value=0;
+		for (auto& entry: row) {
+			auto i=x.find(entry.first);
+			if (i!=x.end()) value+=entry.second*i->second;
+		}
+		if (value!=0) return false;
+	}
+	return true;
+}
+
+/** A sparse linear system with rational coefficients, solved by fraction-free Gauss-Jordan elimination.
+
+	Rows are scaled to primitive integer rows as they are added; elimination keeps the matrix in reduced row echelon form, dividing each row by its content after every step so that coefficients do not grow.
+*/
+class SparseLinearSystem {
+	int columns;
+	std::map<int,IntegerRow> pivots;	///< rows in reduced row echelon form, indexed by the column of their leading coefficient
+public:
+	explicit SparseLinearSystem(int columns) : columns{columns} {}
+	explicit SparseLinearSystem(const IntegerEquations& equations) : columns{equations.columns} {
+		for (auto& row: equations.rows) add_row(row);
+	}
+	int number_of_columns() const {return columns;}
+/** Add the equation sum_i row[i] x_i=0 to the system */
+	void add_row(const RationalRow& row) {add_row(to_integer_row(row));}
+/** Add the equation sum_i row[i] x_i=0 to the system */
+	void add_row(IntegerRow row) {
+		for (auto& pivot: pivots) {
+			if (row.empty()) return;
+			eliminate(row,pivot.second,pivot.first);
+		}
+		if (row.empty()) return;
+		int column=row.front().first;
+		for (auto& pivot: pivots) eliminate(pivot.second,row,column);
+		pivots.emplace(column,std::move(row));
+	}
+	int rank() const {return pivots.size();}
+	std::vector<int> pivot_columns() const {
+		std::vector<int> result;
+		for (auto& pivot: pivots) result.push_back(pivot.first);
+		return result;
+	}
+	std::vector<int> free_columns() const {
+		std::vector<int> result;
+		for (int i=0;i<columns;++i)
+			if (!pivots.count(i)) result.push_back(i);
+		return result;
+	}
+/** Return a basis of the space of solutions
+	@return the solutions obtained by setting one free variable equal to one and the others to zero, in increasing order of the free variable
+
+	Since the matrix is in reduced row echelon form, this basis only depends on the order of the columns, and coincides with the basis obtained by solving the system by Gauss elimination.
+*/
+	std::vector<RationalRow> kernel() const {
+		std::vector<RationalRow> result;
+		for (int free: free_columns()) {
+			RationalRow solution;
+			solution[free]=1;
+			for (auto& pivot: pivots) {
+				mpz_class a=coefficient(pivot.second,free);
+				if (a==0) continue;
+				mpq_class x{-a,pivot.second.front().second};
+				x.canonicalize();
+				solution[pivot.first]=x;
+			}
+			result.push_back(std::move(solution));
+		}
+		return result;
+	}
+};
+
+#endif
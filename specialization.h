@@ -0,0 +1,348 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPECIALIZATION_H
+#define SPECIALIZATION_H
+
+#include <thread>
+#include <atomic>
+#include "derivations.h"
+#include "rationalfunction.h"
+#include "polynomiallinear.h"
+
+/** The outcome of the exact computation for one value of the parameter */
+struct Specialization {
+	mpq_class value;							///< the value of the parameter
+	int rank=0;										///< the rank of the derivation equations, so that dim Der is n^2-rank
+	vector<int> pivots;						///< the pivot columns of the derivation equations, which determine the shape of the basis of Der
+	vector<RationalRow> derivations;	///< a basis of Der, as vectors of matrix entries indexed by l*n+i
+	bool consistent=false;					///< true if the equations tr(ND)=tr(D) have a solution in Der
+	vector<int> gram_pivots;				///< the pivot columns of the equations tr(ND)=tr(D)
+	RationalRow N;								///< the solution N of tr(ND)=tr(D) with the free coordinates set to zero, as a vector of matrix entries
+};
+
+/** Return tr(AB) for matrices given as vectors of entries indexed by l*n+i */
+inline mpq_class trace_of_product(const RationalRow& A, const RationalRow& B, int n) {
+	mpq_class result;
+	for (auto& a: A) {
+		int l=a.first/n, i=a.first%n;
+		auto b=B.find(i*n+l);
+		if (b!=B.end()) result+=a.second*b->second;
+	}
+	return result;
+}
+
+inline mpq_class trace(const RationalRow& A, int n) {
+	mpq_class result;
+	for (auto& a: A)
+		if (a.first/n==a.first%n) result+=a.second;
+	return result;
+}
+
+/** Solve the derivation equations for one value of the parameter, and the equations tr(ND)=tr(D) for N in the space of derivations
+	@param equations The derivation equations, @sa derivation_equations
+	@param n The dimension of the Lie algebra
+	@param value The value of the parameter
+	@return The result of the computation
+
+	Only GMP arithmetic is involved, so that different values can be processed in different threads.
+*/
+Specialization specialize(const IntegerEquations& equations, int n, const mpq_class& value) {
+	Specialization result;
+	result.value=value;
+	SparseLinearSystem system{equations};
+	result.rank=system.rank();
+	result.pivots=system.pivot_columns();
+	result.derivations=system.kernel();
+	int m=result.derivations.size();
+	SparseLinearSystem gram{m+1};			//the unknowns are the coordinates x_j of N=sum x_j D_j, followed by a constant term
+	for (int i=0;i<m;++i) {
+		RationalRow row;
+		for (int j=0;j<m;++j) {
+			auto b=trace_of_product(result.derivations[i],result.derivations[j],n);
+			if (b!=0) row[j]=b;
+		}
+		auto t=trace(result.derivations[i],n);
+		if (t!=0) row[m]=-t;
+		gram.add_row(row);
+	}
+	result.gram_pivots=gram.pivot_columns();
+	result.consistent=result.gram_pivots.empty() || result.gram_pivots.back()!=m;
+	if (!result.consistent) return result;
+	for (auto& x: gram.kernel()) {
+		auto constant=x.find(m);
+		if (constant==x.end() || constant->second==0) continue;
+		for (auto& entry: x) {
+			if (entry.first==m) continue;
+			for (auto& d: result.derivations[entry.first])
+				result.N[d.first]+=entry.second/constant->second*d.second;
+		}
+		break;
+	}
+	for (auto i=result.N.begin();i!=result.N.end();)
+		if (i->second==0) i=result.N.erase(i);
+		else ++i;
+	return result;
+}
+
+/** Specialize the parameter at each of the given values and solve the resulting systems, using a pool of threads
+	@param c The structure constants of a Lie algebra depending on one parameter
+	@param parameter The parameter
+	@param values The values of the parameter
+	@param threads The number of threads
+	@return The results, in the order of values; values where the structure constants are not defined are omitted
+
+	Substitution and the construction of the equations use GiNaC, which is not thread-safe, and take place in the calling thread; only the exact linear algebra is run in parallel.
+*/
+vector<Specialization> specialize(const StructureConstants& c, ex parameter, const vector<mpq_class>& values, int threads) {
+	vector<pair<mpq_class,IntegerEquations>> systems;
+	for (auto& value: values) {
+		try {
+			auto equations=derivation_equations(c.subs(parameter==to_numeric(value)));
+			if (equations) systems.emplace_back(value,move(*equations));
+		}
+		catch (const std::domain_error&) {}		//the structure constants have a pole at value
+		catch (const std::overflow_error&) {}
+	}
+	vector<Specialization> result(systems.size());
+	atomic<int> next{0};
+	auto worker=[&] () {
+		for (int i;(i=next++)<systems.size();)
+			result[i]=specialize(systems[i].second,c.dimension(),systems[i].first);
+	};
+	vector<thread> pool;
+	for (int i=1;i<threads;++i) pool.emplace_back(worker);
+	worker();
+	for (auto& t: pool) t.join();
+	return result;
+}
+
+/** The Nikolayevsky-like derivation of a Lie algebra depending on one parameter, as a function of the parameter on the generic stratum */
+struct GenericNikolayevsky {
+	ex parameter;
+	int dimension_of_derivations;	///< dim Der for generic values of the parameter
+	ex denominator;								///< a polynomial in the parameter that vanishes at all values where the computation may not be valid
+	matrix N;											///< the derivation N satisfying tr(ND)=tr(D) for all derivations, normalized as in Specialization
+	exvector derivations;					///< a basis of Der, as matrices
+	vector<mpq_class> exceptional;	///< the rational values of the parameter where dim Der differs from the generic one, in increasing order
+	ex possibly_exceptional=1;			///< a product of irreducible polynomials of degree greater than one; dim Der is generic at all values that are not exceptional and not roots of this polynomial or of the denominator
+};
+
+/** Reconstruct each entry of a rational vector depending on the parameter as a rational function, given its values at sample points
+	@param samples The generic specializations used for the reconstruction
+	@param entry A function returning the vector for a specialization
+	@param columns The set of indices of entries that may be nonzero
+	@return A map from indices to rational functions, or nothing if some entry has too high degree
+*/
+template<typename Entry> optional<map<int,RationalFunction>> reconstruct(const vector<const Specialization*>& samples, Entry&& entry, const set<int>& columns) {
+	vector<mpq_class> points;
+	for (auto s: samples) points.push_back(s->value);
+	map<int,RationalFunction> result;
+	for (int column: columns) {
+		vector<mpq_class> values;
+		for (auto s: samples) {
+			auto& row=entry(*s);
+			auto i=row.find(column);
+			values.push_back(i==row.end()? mpq_class{0} : i->second);
+		}
+		auto f=rational_function_reconstruction(points,values);
+		if (!f) return nullopt;
+		if (!f->numerator.empty()) result.emplace(column,move(*f));
+	}
+	return result;
+}
+
+/** Check a reconstruction against the specializations that were not used to compute it */
+template<typename Entry> bool agrees(const map<int,RationalFunction>& functions, const vector<const Specialization*>& samples, Entry&& entry) {
+	for (auto s: samples) {
+		auto& row=entry(*s);
+		for (auto& x: row)
+			if (!functions.count(x.first)) return false;
+		for (auto& f: functions) {
+			if (evaluate(f.second.denominator,s->value)==0) return false;
+			auto i=row.find(f.first);
+			if (evaluate(f.second,s->value)!=(i==row.end()? mpq_class{0} : i->second)) return false;
+		}
+	}
+	return true;
+}
+
+inline ex to_ex(const RationalPolynomial& p, ex x) {
+	ex result;
+	for (int i=p.size()-1;i>=0;--i) result=result*x+to_numeric(p[i]);
+	return result;
+}
+
+inline ex to_ex(const RationalFunction& f, ex x) {
+	return to_ex(f.numerator,x)/to_ex(f.denominator,x);
+}
+
+/** Determine the values of the parameter where dim Der differs from its generic value
+	@param c The structure constants of a Lie algebra depending on one parameter
+	@param result The generic derivation, whose fields exceptional and possibly_exceptional are set
+
+	The derivation equations are reduced by fraction-free elimination over Q[parameter], so that dim Der is generic at all values where the conditions returned by PolynomialLinearSystem::degeneracy_conditions do not vanish. The conditions are factored over Q. The roots of the linear factors are checked by solving the specialized equations exactly; the other factors are collected in result.possibly_exceptional, unless they divide the denominator. Since the equations have rational coefficients, dim Der takes the same value at all the roots of an irreducible factor. Roots of the denominators of the structure constants are ignored, since the Lie algebra is not defined there.
+*/
+void find_exceptional_values(const StructureConstants& c, GenericNikolayevsky& result) {
+	ex lambda=result.parameter;
+	int n=c.dimension();
+	PolynomialLinearSystem system{n*n+1};
+	ex poles=1;
+	for (int i=0;i<n;++i)
+	for (int j=i+1;j<n;++j) {
+		vector<map<int,ex>> rows(n);		//the coefficients of the components of Xbracket(c,a,i,j) in the entries of a
+		for (int l=0;l<n;++l) {
+			for (auto& x: c.bracket(l,j)) rows[x.k][l*n+i]+=x.c;
+			for (auto& x: c.bracket(i,l)) rows[x.k][l*n+j]+=x.c;
+		}
+		for (auto& x: c.bracket(i,j)) {
+			poles=lcm(poles,x.c.normal().denom());
+			for (int k=0;k<n;++k) rows[k][k*n+x.k]-=x.c;
+		}
+		for (auto& row: rows) {
+			PolynomialRow polynomial_row;
+			for (auto& entry: row) {
+				ex coefficient=entry.second.normal();
+				if (!coefficient.is_zero()) polynomial_row.emplace_back(entry.first,coefficient);
+			}
+			if (!polynomial_row.empty()) system.add_row(move(polynomial_row));
+		}
+	}
+	set<ex,ex_is_less> factors;		//monic irreducible factors of the conditions
+	for (auto& condition: system.degeneracy_conditions()) {
+		ex factored=factor(condition.normal().numer());
+		for (auto f: is_a<mul>(factored)? exvector(factored.begin(),factored.end()) : exvector{factored}) {
+			if (is_a<power>(f)) f=f.op(0);
+			f=f.expand();
+			if (f.degree(lambda)>0) factors.insert((f/f.lcoeff(lambda)).expand());
+		}
+	}
+	int generic_rank=n*n-result.dimension_of_derivations;
+	ex denominator=result.denominator.expand(), quotient;
+	poles=poles.expand();
+	result.exceptional.clear();
+	result.possibly_exceptional=1;
+	for (auto& f: factors) {
+		if (divide(poles,f,quotient)) continue;
+		if (f.degree(lambda)>1) {
+			if (!divide(denominator,f,quotient)) result.possibly_exceptional*=f;
+			continue;
+		}
+		auto root=to_mpq(ex_to<numeric>(-f.coeff(lambda,0)));
+		auto specialization=specialize(c,lambda,{root},1);
+		if (!specialization.empty() && specialization[0].rank!=generic_rank) result.exceptional.push_back(root);
+	}
+	sort(result.exceptional.begin(),result.exceptional.end());
+}
+
+/** Compute the Nikolayevsky-like derivation of a Lie algebra depending on one parameter by specializing the parameter at rational values
+	@param c The structure constants of a Lie algebra
+	@param threads The number of threads used to solve the specialized systems
+	@return The derivation as a function of the parameter on the generic stratum, or nothing if the structure constants do not depend on exactly one parameter, if they depend on it non-rationally, or if the reconstruction fails
+
+	The derivation equations are solved exactly at a number of sample values. The generic dimension of Der is the smallest dimension observed, since the rank of the equations can only drop on a Zariski-closed set; specializations where the rank or the pivot pattern differ from the most common generic ones are not used. The basis of Der in reduced form and the solution N of tr(ND)=tr(D) are then reconstructed entrywise as rational functions, doubling the number of samples until the reconstruction is confirmed by samples that were not used to compute it. Finally, N and the basis are checked symbolically to be derivations, and tr(ND)=tr(D) is checked on the basis, so that the result is exact for all values of the parameter that are not roots of the denominator and where dim Der is generic. The values where dim Der is not generic are then determined exactly, @sa find_exceptional_values.
+*/
+optional<GenericNikolayevsky> generic_nikolayevsky(const StructureConstants& c, int threads=1) {
+	auto parameters=c.symbols<StructureConstant>();
+	if (parameters.size()!=1) return nullopt;
+	ex lambda=parameters[0];
+	int n=c.dimension();
+	vector<mpq_class> probes{0,1,-1,2,-2,mpq_class{1,2},mpq_class{-1,2},3,mpq_class{1,3}};
+	vector<Specialization> results=specialize(c,lambda,probes,threads);
+	set<mpq_class> used{probes.begin(),probes.end()};		//interpolation requires distinct points
+	const int max_samples=128, held_out=3;
+	int sampled=0, k=0;
+	for (int samples=8;samples<=max_samples;samples*=2) {
+		vector<mpq_class> values;
+		while (sampled<samples+held_out) {
+			mpq_class value{13*k+5,k+17};		//unlikely to be exceptional
+			++k;
+			value.canonicalize();
+			if (!used.insert(value).second) continue;
+			values.push_back(value);
+			++sampled;
+		}
+		auto more=specialize(c,lambda,values,threads);
+		results.insert(results.end(),more.begin(),more.end());
+		int generic_rank=0;
+		for (auto& s: results) generic_rank=max(generic_rank,s.rank);
+		map<pair<vector<int>,vector<int>>,int> patterns;
+		for (auto& s: results)
+			if (s.rank==generic_rank && s.consistent) ++patterns[{s.pivots,s.gram_pivots}];
+		if (patterns.empty()) continue;
+		auto generic=max_element(patterns.begin(),patterns.end(),[] (auto& x, auto& y) {return x.second<y.second;})->first;
+		vector<const Specialization*> fit, check;
+		GenericNikolayevsky result{lambda,n*n-generic_rank};
+		for (auto& s: results) {
+			if (s.rank!=generic_rank || !s.consistent || s.pivots!=generic.first || s.gram_pivots!=generic.second) continue;
+			if (fit.size()<samples) fit.push_back(&s);
+			else check.push_back(&s);
+		}
+		if (check.size()<held_out) continue;
+		set<int> columns;
+		for (auto s: fit) for (auto& x: s->N) columns.insert(x.first);
+		auto N=reconstruct(fit,[] (const Specialization& s) -> const RationalRow& {return s.N;},columns);
+		if (!N || !agrees(*N,check,[] (const Specialization& s) -> const RationalRow& {return s.N;})) continue;
+		vector<map<int,RationalFunction>> basis;
+		for (int j=0;j<result.dimension_of_derivations;++j) {
+			auto derivation=[j] (const Specialization& s) -> const RationalRow& {return s.derivations[j];};
+			set<int> columns;
+			for (auto s: fit) for (auto& x: s->derivations[j]) columns.insert(x.first);
+			auto D=reconstruct(fit,derivation,columns);
+			if (!D || !agrees(*D,check,derivation)) break;
+			basis.push_back(move(*D));
+		}
+		if (basis.size()!=result.dimension_of_derivations) continue;
+		RationalPolynomial denominator{1};
+		auto to_matrix=[&] (const map<int,RationalFunction>& functions) {
+			matrix A(n,n);
+			for (auto& f: functions) {
+				A(f.first/n,f.first%n)=to_ex(f.second,lambda);
+				if (!divide(denominator,f.second.denominator).second.empty()) denominator=denominator*f.second.denominator;
+			}
+			return A;
+		};
+		result.N=to_matrix(*N);
+		for (auto& D: basis) result.derivations.push_back(to_matrix(D));
+		result.denominator=to_ex(denominator,lambda);
+		auto entries=[n] (const matrix& A) {
+			exvector a(n*n);
+			for (int li=0;li<n*n;++li) a[li]=A(li/n,li%n);
+			return a;
+		};
+		auto is_derivation=[&] (const matrix& A) {
+			auto a=entries(A);
+			for (int i=0;i<n;++i)
+			for (int j=i+1;j<n;++j)
+				for (auto& x: Xbracket(c,a,i,j))
+					if (!x.normal().is_zero()) return false;
+			return true;
+		};
+		bool verified=is_derivation(result.N);
+		for (auto& D: result.derivations) {
+			auto& A=ex_to<matrix>(D);
+			verified=verified && is_derivation(A) && (result.N.mul(A).trace()-A.trace()).normal().is_zero();
+		}
+		if (!verified) continue;
+		find_exceptional_values(c,result);
+		return result;
+	}
+	return nullopt;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "record.h"
+
+/** Write an unsigned 32-bit integer in little-endian order */
+inline void write_uint32(std::ostream& os, uint32_t x) {
+	char bytes[4];
+	for (int i=0;i<4;++i,x>>=8) bytes[i]=static_cast<char>(x&0xff);
+	os.write(bytes,4);
+}
+
+inline bool read_uint32(std::istream& is, uint32_t& x) {
+	unsigned char bytes[4];
+	if (!is.read(reinterpret_cast<char*>(bytes),4)) return false;
+	x=0;
+	for (int i=3;i>=0;--i) x=(x<<8)|bytes[i];
+	return true;
+}
+
+/** A file of results with random access by the name of the Lie algebra.
+
+	The data file starts with a header line listing the fields of StudyRecord; each record follows as the name of the Lie algebra and the fields in the same order, each written as its length in little-endian 32-bit form followed by its bytes. The index file, named after the data file with the extension .index, contains one line per record with its name, its offset and its structure constants, separated by tabs, so that a record can be read without scanning the data file, and the Lie algebras in the store can be listed without reading it; the structure constants may be missing in index files written by earlier versions. If a name occurs more than once, the last record prevails.
+
+	Several processes may append to the same store, e.g. the shards of a run or a server next to a batch run: each record and its index line are written while holding an exclusive lock on the data file, @sa flock. Records appended by other processes after a store is opened are not visible through it. An index line left incomplete by a process that was killed while writing it is ignored.
+*/
+class ResultStore {
+	std::string path;
+	std::fstream data;
+	std::ofstream index_file;
+	struct Entry {
+		std::streamoff offset;
+		std::string structure_constants;		///< empty if not in the index file
+	};
+	std::map<std::string,Entry> index;
+	int lock_fd=-1;		///< a descriptor of the data file, locked while the files are modified
+
+/** An exclusive lock on the data file, held for the lifetime of the object */
+	class Lock {
+		int fd;
+	public:
+		explicit Lock(int fd) : fd{fd} {
+			while (flock(fd,LOCK_EX)<0)
+				if (errno!=EINTR) throw std::runtime_error("cannot lock store");
+		}
+		~Lock() {flock(fd,LOCK_UN);}
+		Lock(const Lock&)=delete;
+		Lock& operator=(const Lock&)=delete;
+	};
+
+	static std::string header() {
+		StudyRecord record;
+		std::string result="gleipnir-store";
+		for (auto& field: fields(record)) result+=std::string{' '}+field.first;
+		return result;
+	}
+/** Read the index file, skipping malformed lines
+	@return false if the last line is not terminated by a newline
+*/
+	bool load_index() {
+		std::ifstream file{path+".index"};
+		std::string line;
+		while (getline(file,line)) {
+			if (file.eof()) return false;		//cut short by a crash
+			auto tab=line.find('\t');
+			if (tab==std::string::npos) continue;
+			auto second_tab=std::min(line.find('\t',tab+1),line.size());
+			auto offset_field=line.substr(tab+1,second_tab-tab-1);
+			size_t end=0;
+			long long offset=-1;
+			try {offset=std::stoll(offset_field,&end);}
+			catch (const std::exception&) {continue;}
+			if (end!=offset_field.size() || offset<=0) continue;
+			index[line.substr(0,tab)]=Entry{offset,second_tab<line.size()? line.substr(second_tab+1) : std::string{}};
+		}
+		return true;
+	}
+public:
+/** Open a store, creating it if it does not exist
+	@param path The name of the data file
+	@exception std::runtime_error if the file cannot be opened, or was written with different fields
+*/
+	explicit ResultStore(const std::string& path) : path{path} {
+		std::ofstream{path,std::ios::binary | std::ios::app};		//create the file if needed, without truncating it
+		data.open(path,std::ios::in | std::ios::out | std::ios::binary);
+		lock_fd=open(path.c_str(),O_RDONLY | O_CLOEXEC);
+		if (!data || lock_fd<0) throw std::runtime_error("cannot open store "+path);
+		Lock lock{lock_fd};
+		std::string line;
+		bool terminated=true;
+		if (!getline(data,line)) {
+			data.clear();
+			data.seekp(0,std::ios::end);
+			data<<header()<<'\n';
+			data.flush();
+		}
+		else if (line!=header()) throw std::runtime_error(path+" is not a store written by this version of gleipnir");
+		else terminated=load_index();
+		index_file.open(path+".index",std::ios::app);
+		if (!index_file) throw std::runtime_error("cannot open "+path+".index");
+		if (!terminated) index_file<<'\n'<<std::flush;		//so that the next line is not appended to the incomplete one
+	}
+	~ResultStore() {
+		if (lock_fd>=0) close(lock_fd);
+	}
+	ResultStore(const ResultStore&)=delete;
+	ResultStore& operator=(const ResultStore&)=delete;
+/** Append a record to the store
+	@param name The name of the Lie algebra, which must not contain tabs or newlines
+	@param record The results
+*/
+	void append(const std::string& name, const StudyRecord& record) {
+		Lock lock{lock_fd};
+		data.clear();
+		data.seekp(0,std::ios::end);
+		auto offset=static_cast<std::streamoff>(data.tellp());
+		write_uint32(data,name.size());
+		data<<name;
+		for (auto& field: fields(record)) {
+			write_uint32(data,field.second->size());
+			data<<*field.second;
+		}
+		data.flush();
+		index_file<<name<<'\t'<<offset<<'\t'<<record.structure_constants<<'\n';
+		index_file.flush();
+		index[name]=Entry{offset,record.structure_constants};
+	}
+/** Read the record of a Lie algebra
+	@param name The name of the Lie algebra
+	@return The record, or nothing if the store does not contain it
+*/
+	std::optional<StudyRecord> load(const std::string& name) {
+		auto i=index.find(name);
+		if (i==index.end()) return std::nullopt;
+		data.clear();
+		data.seekg(i->second.offset);
+		auto read_string=[this] (std::string& s) {
+			uint32_t size;
+			if (!read_uint32(data,size)) return false;
+			s.resize(size);
+			return size==0 || static_cast<bool>(data.read(&s[0],size));
+		};
+		std::string stored_name;
+		StudyRecord record;
+		if (!read_string(stored_name) || stored_name!=name) return std::nullopt;
+		for (auto& field: fields(record))
+			if (!read_string(*field.second)) return std::nullopt;
+		return record;
+	}
+/** Return the structure constants of a Lie algebra, reading them from the index file if possible rather than from the record
+	@param name The name of the Lie algebra
+	@return The normal form of the structure constants, or nothing if the store does not contain the Lie algebra
+*/
+	std::optional<std::string> structure_constants(const std::string& name) {
+		auto i=index.find(name);
+		if (i==index.end()) return std::nullopt;
+		if (!i->second.structure_constants.empty()) return i->second.structure_constants;
+		auto record=load(name);
+		if (!record) return std::nullopt;
+		return record->structure_constants;
+	}
+/** The names of the Lie algebras in the store, in alphabetical order */
+	std::vector<std::string> names() const {
+		std::vector<std::string> result;
+		for (auto& entry: index) result.push_back(entry.first);
+		return result;
+	}
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STRUCTURECONSTANTS_H
+#define STRUCTURECONSTANTS_H
+
+#include <wedge/wedge.h>
+
+using namespace GiNaC;
+using namespace std;
+using namespace Wedge;
+
+/** A nonzero component c_ij^k of the bracket [e_i,e_j] */
+struct BracketComponent {
+	int k;	///< zero-based index of the basis element
+	ex c;		///< the coefficient of e_k in [e_i,e_j]
+};
+
+/** The structure constants c_ij^k of a Lie algebra, defined by [e_i,e_j]=c_ij^k e_k, stored in compressed sparse row form.
+
+	Indices are zero-based. The components of [e_i,e_j] are stored for all ordered pairs (i,j), so that c_ji^k=-c_ij^k is available without sign bookkeeping; the pairs i<j with nonzero bracket are indexed separately.
+*/
+class StructureConstants {
+	int n;
+	vector<int> offsets;			//components of [e_i,e_j] are stored in the range [offsets[i*n+j],offsets[i*n+j+1]) of components
+	vector<BracketComponent> components;
+	vector<pair<int,int>> nonzero;
+	bool rational=true;
+/** Fill the compressed representation
+	@param brackets For i<j, the element i*n+j contains the components of [e_i,e_j]; zero components are discarded
+*/
+	void build(const vector<vector<BracketComponent>>& brackets) {
+		vector<vector<BracketComponent>> all(n*n);
+		for (int i=0;i<n;++i)
+		for (int j=i+1;j<n;++j) {
+			for (auto& x: brackets[i*n+j]) {
+				if (x.c.is_zero()) continue;
+				if (!is_a<numeric>(x.c) || !ex_to<numeric>(x.c).is_rational()) rational=false;
+				all[i*n+j].push_back(x);
+				all[j*n+i].push_back({x.k,-x.c});
+			}
+			if (!all[i*n+j].empty()) nonzero.emplace_back(i,j);
+		}
+		offsets.resize(n*n+1);
+		for (int ij=0;ij<n*n;++ij) {
+			offsets[ij]=components.size();
+			components.insert(components.end(),all[ij].begin(),all[ij].end());
+		}
+		offsets[n*n]=components.size();
+	}
+	StructureConstants(int n, const vector<vector<BracketComponent>>& brackets) : n{n} {build(brackets);}
+public:
+	class Range {
+		const BracketComponent* b;
+		const BracketComponent* e;
+	public:
+		Range(const BracketComponent* begin, const BracketComponent* end) : b{begin}, e{end} {}
+		const BracketComponent* begin() const {return b;}
+		const BracketComponent* end() const {return e;}
+		bool empty() const {return b==e;}
+	};
+
+/** Compute the structure constants of a Lie group
+	@param G a Lie group, with or without parameters
+
+	Each bracket [e_i,e_j] with i<j is computed symbolically exactly once.
+*/
+	explicit StructureConstants(const LieGroup& G) : n{G.Dimension()} {
+		vector<vector<BracketComponent>> brackets(n*n);
+		for (int i=0;i<n;++i)
+		for (int j=i+1;j<n;++j) {
+			ex bracket=G.LieBracket(G.e(i+1),G.e(j+1)).expand();
+			if (!bracket.is_zero()) 
+				for (int k=0;k<n;++k) 
+					brackets[i*n+j].push_back({k,bracket.coeff(G.e(k+1))});
+		}
+		build(brackets);
+	}
+/** Return the structure constants obtained by substituting values for the parameters
+	@param substitution A relation or list of relations, as accepted by ex::subs
+*/
+	StructureConstants subs(const ex& substitution) const {
+		vector<vector<BracketComponent>> brackets(n*n);
+		for (auto ij: nonzero)
+			for (auto& x: bracket(ij.first,ij.second))
+				brackets[ij.first*n+ij.second].push_back({x.k,x.c.subs(substitution).normal()});
+		return StructureConstants{n,brackets};
+	}
+	int dimension() const {return n;}
+/** The nonzero components of [e_i,e_j] */
+	Range bracket(int i, int j) const {
+		return {components.data()+offsets[i*n+j],components.data()+offsets[i*n+j+1]};
+	}
+/** The pairs (i,j) with i<j and [e_i,e_j] nonzero */
+	const vector<pair<int,int>>& nonzero_brackets() const {return nonzero;}
+/** The symbols of a given type appearing in the structure constants, such as the parameters of type StructureConstant */
+	template<typename Symbol> exvector symbols() const {
+		list<ex> found;
+		for (auto& x: components) GetSymbols<Symbol>(found,x.c);
+		set<ex,ex_is_less> unique{found.begin(),found.end()};
+		return {unique.begin(),unique.end()};
+	}
+/** True if all structure constants are rational numbers, i.e. the Lie algebra does not depend on parameters */
+	bool is_rational() const {return rational;}
+/** Return a normal form of the structure constants, which does not depend on the way the Lie algebra was entered
+	@return A string containing the dimension followed by the nonzero c_ij^k with i<j, in the form i,j,k:c_ij^k with one-based indices
+*/
+	string normal_form() const {
+		stringstream s;
+		s<<dflt<<n;
+		for (auto ij: nonzero)
+			for (auto& x: bracket(ij.first,ij.second))
+				s<<';'<<ij.first+1<<','<<ij.second+1<<','<<x.k+1<<':'<<x.c;
+		return s.str();
+	}
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gleipnir.h"
+#include "nikolayevsky.h"
+#include "classification.h"
+#include "specialization.h"
+#include "studycontext.h"
+
+/** Compute the Nikolayevsky derivation of a Lie algebra with one parameter by specialization, @sa generic_nikolayevsky */
+GenericNikolayevskyResult generic_nikolayevsky_result(const StructureConstants& c, int threads) {
+	GenericNikolayevskyResult result;
+	auto generic=generic_nikolayevsky(c,threads);
+	if (!generic) return result;
+	result.computed=true;
+	result.parameter=generic->parameter;
+	result.N=generic->N;
+	result.denominator=generic->denominator;
+	result.dimension_of_derivations=generic->dimension_of_derivations;
+	for (auto& value: generic->exceptional) result.exceptional.push_back(to_numeric(value));
+	result.possibly_exceptional=generic->possibly_exceptional;
+	return result;
+}
+
+/** Return the number of nodes in the expression tree of an expression */
+long expression_nodes(const ex& e) {
+	long result=1;
+	for (size_t i=0;i<e.nops();++i) result+=expression_nodes(e.op(i));
+	return result;
+}
+
+/** Return the number of nodes in the expressions of the results of a study, as a measure of their size; GiNaC does not keep count of the expressions it creates */
+long expression_nodes(const StudyResult& result) {
+	long nodes=expression_nodes(result.generic_derivation)+expression_nodes(result.trace_form)+expression_nodes(result.nikolayevsky)+expression_nodes(result.generic_centralizer_element);
+	for (auto& X: result.derivation_basis) nodes+=expression_nodes(X);
+	for (auto& X: result.null_space) nodes+=expression_nodes(X);
+	for (auto& X: result.centralizer) nodes+=expression_nodes(X);
+	for (auto& x: result.eigenvalues) nodes+=expression_nodes(x);
+	for (auto& x: result.derivation_when) nodes+=expression_nodes(x);
+	for (auto& x: result.nikolayevsky_when) nodes+=expression_nodes(x);
+	if (result.centralizer_derivation_when)
+		for (auto& x: *result.centralizer_derivation_when) nodes+=expression_nodes(x);
+	return nodes;
+}
+
+StudyResult study(const LieGroup& G, const StudyOptions& options) {
+	reset_peak_rss();		//so that the peak refers to this study, rather than to earlier ones in the same process or in the parent of a worker
+	StructureConstants c{G};
+	StudyContext context{G,c,options.threads};
+	StudyResult result;
+	Stopwatch stopwatch{result.telemetry};
+	context.derivations();
+	stopwatch.lap("derivations");
+	auto& nik_like_derivations=context.nikolayevsky_like_derivations();
+	stopwatch.lap("nikolayevsky");
+	auto nikolayevsky_when=context.nikolayevsky_derivation_when();
+	stopwatch.lap("nikolayevsky_when");
+	auto nik=Nikolayevsky(nik_like_derivations.N_as_matrix,nikolayevsky_when);
+	result.nikolayevsky=nik.as_matrix();
+	result.nikolayevsky_when=nik.conditions();
+	result.nikolayevsky_computed=nik.computed();
+	if (nik.computed()) result.eigenvalues=nik.eigenvalues();
+	result.nikolayevsky_description=nik.to_string();
+	stopwatch.lap("eigenvalues");
+	if (options.specialize && !c.is_rational()) {
+		result.generic_nikolayevsky=generic_nikolayevsky_result(c,options.specialize);
+		stopwatch.lap("specialization");
+	}
+	result.trace_form=nik_like_derivations.trace_form.gram;
+	result.derivation_basis=nik_like_derivations.trace_form.matrices;
+	result.null_space=nik_like_derivations.W_as_matrices;
+	auto centralizer_of_nik=centralizer(nik_like_derivations);	//a space which contains the centralizer of the Nikolayevsky derivation inside the null space of the trace form
+	auto& Gl=context.general_linear();
+	result.generic_centralizer_element=Gl.glToMatrix(centralizer_of_nik.GenericElement());
+	for (auto X: centralizer_of_nik.e()) result.centralizer.push_back(Gl.glToMatrix(X));
+	stopwatch.lap("centralizer");
+	result.generic_derivation=context.generic_derivation();
+	result.derivation_when=context.derivation_when(context.der().GenericElement());
+	if (!nik_like_derivations.N.is_zero() && !(nik.computed() && !centralizer_of_nik.Dimension()))
+		result.centralizer_derivation_when=context.derivation_when(centralizer_of_nik.GenericElement());
+	stopwatch.lap("derivation_when");
+	result.telemetry.peak_rss_kilobytes=peak_rss_kilobytes();
+	result.telemetry.expression_nodes=expression_nodes(result);
+	return result;
+}
+
+StudyResult study(const string& lie_algebra, const StudyOptions& options) {
+	return study(*lie_group_from_string(lie_algebra),options);
+}
+
+optional<int> derivation_dimension_modulo_primes(const LieGroup& G) {
+	auto equations=derivation_equations(StructureConstants{G});
+	if (!equations) return nullopt;
+	return modular_kernel_dimension(*equations);
+}
+
+void prepare_dimension(int n) {
+	gl_of_dimension(n);
+}
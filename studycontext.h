@@ -0,0 +1,152 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STUDYCONTEXT_H
+#define STUDYCONTEXT_H
+
+#include "nice.h"
+
+/** Return the Lie algebra of GL(n,R), constructed at most once for each n
+
+	Constructing GL(n,R) involves symbolic computations with its n^2 generators, and all the entries of a classification typically share the same dimension. Instances created before forking are shared with child processes.
+*/
+const GL& gl_of_dimension(int n) {
+	static map<int,unique_ptr<GL>> pool;
+	auto& gl=pool[n];
+	if (!gl) gl=make_unique<GL>(n);
+	return *gl;
+}
+
+/** The intermediate results of the study of a Lie group, each computed lazily at most once and shared by all the stages
+
+	The action of gl on the Lie algebra is computed symbolically only for the generic element of gl; the matrix of any other element is obtained by linearity, and the conditions for it to be a derivation are read off the structure constants, @sa Xbracket.
+*/
+class StudyContext {
+	const LieGroup& G;
+	StructureConstants c;
+	const GL& Gl;
+	VectorSpace<DifferentialForm> gl;
+	optional<exvector> generic_action_;
+	optional<vector<pair<ex,vector<pair<int,ex>>>>> action_of_basis_;	//for each basis element of gl, the nonzero entries of its matrix
+	optional<VectorSpaceBetween> derivations_;
+	optional<VectorSpace<DifferentialForm>> der_;
+	optional<AffineSpaceInGl> nikolayevsky_;
+	bool nikolayevsky_from_root_matrix_=false;
+	optional<matrix> generic_derivation_;
+	int threads;
+public:
+/** Create a context for the study of a Lie group
+	@param G A Lie group
+	@param c The structure constants of G
+	@param threads The number of threads used to solve the equations for the derivations, @sa derivations_parametric
+*/
+	StudyContext(const LieGroup& G, StructureConstants c, int threads=1) : G{G}, c{move(c)}, Gl{gl_of_dimension(G.Dimension())}, gl{Gl.pForms(1)}, threads{threads} {}
+	StudyContext(const StudyContext&)=delete;
+	const LieGroup& group() const {return G;}
+	const StructureConstants& structure_constants() const {return c;}
+	const GL& general_linear() const {return Gl;}
+/** The matrix of the generic element of gl, as returned by action_matrix */
+	const exvector& generic_action() {
+		if (!generic_action_) generic_action_=action_matrix(G,GLRepresentation<VectorField>(&Gl,G.e()),gl.GenericElement());
+		return *generic_action_;
+	}
+/** The matrix of an element of gl, as a vector of size n^2 whose entry l*n+i is the coefficient of e_l in Ae_i */
+	exvector action(ex A) {
+		if (!action_of_basis_) {
+			auto& a=generic_action();
+			auto generic_element=gl.GenericElement().expand();
+			action_of_basis_.emplace();
+			for (auto x=gl.coordinate_begin();x!=gl.coordinate_end();++x) {
+				vector<pair<int,ex>> entries;
+				for (int li=0;li<a.size();++li) {
+					ex entry=a[li].coeff(*x);
+					if (!entry.is_zero()) entries.emplace_back(li,entry);
+				}
+				action_of_basis_->emplace_back(generic_element.coeff(*x),move(entries));
+			}
+		}
+		A=A.expand();
+		exvector result(c.dimension()*c.dimension());
+		for (auto& basis_element: *action_of_basis_) {
+			ex coefficient=A.coeff(basis_element.first);
+			if (coefficient.is_zero()) continue;
+			for (auto& entry: basis_element.second) result[entry.first]+=coefficient*entry.second;
+		}
+		return result;
+	}
+/** The space of derivations, @sa derivations_parametric */
+	const VectorSpaceBetween& derivations() {
+		if (!derivations_) derivations_=derivations_parametric<StructureConstant>(c,gl,generic_action(),threads);
+		return *derivations_;
+	}
+/** The larger space in derivations(), as a vector space */
+	const VectorSpace<DifferentialForm>& der() {
+		if (!der_) der_.emplace(derivations().basis_of_larger_space);
+		return *der_;
+	}
+/** The affine space that contains the Nikolayevsky derivation, @sa nikolayevsky_like_derivations_parametric
+
+	If the basis is nice, N is the Nikolayevsky derivation computed from the root matrix, verified against the space of derivations, @sa nice_nikolayevsky; otherwise, N is obtained by solving the equations tr(ND)=tr(D).
+*/
+	const AffineSpaceInGl& nikolayevsky_like_derivations() {
+		if (!nikolayevsky_) {
+			auto form=trace_form(der(),derivations().basis_of_smaller_space,Gl);
+			if (auto diagonal=nice_nikolayevsky(c)) nikolayevsky_=nice_nikolayevsky_like_derivations(form,*diagonal);
+			nikolayevsky_from_root_matrix_=nikolayevsky_.has_value();
+			if (!nikolayevsky_) nikolayevsky_=solve_nikolayevsky_equations(form,nikolayevsky_equations(form));
+		}
+		return *nikolayevsky_;
+	}
+/** The conditions for N in nikolayevsky_like_derivations() to be a derivation; these are computed only if N was not obtained from the root matrix, in which case it is known to be a derivation */
+	set<ex,ex_is_less> nikolayevsky_derivation_when() {
+		auto& N=nikolayevsky_like_derivations().N;
+		if (nikolayevsky_from_root_matrix_) return {};
+		return derivation_when(N);
+	}
+/** The generic element of der(), as a matrix */
+	const matrix& generic_derivation() {
+		if (!generic_derivation_) generic_derivation_=Gl.glToMatrix(der().GenericElement());
+		return *generic_derivation_;
+	}
+/** Return the set of linear equations that an element of gl should satisfy in order to define a derivation, @sa derivation_when */
+	set<ex,ex_is_less> derivation_when(ex A) {
+		auto a=action(A);
+		set<ex,ex_is_less> eqns;
+		for (int i=0;i<c.dimension();++i)
+		for (int j=i+1;j<c.dimension();++j)
+			for (auto& component: Xbracket(c,a,i,j)) {
+				ex eq=component.expand();
+				if (!eq.is_zero()) eqns.insert(eq);
+			}
+		return eqns;
+	}
+};
+
+/** Print the generic derivation and the conditions for it to be a derivation
+	@return The generic derivation, as a matrix
+*/
+matrix print_derivations(StudyContext& context, ostream& os) {
+	auto& gen_der=context.generic_derivation();
+	os<<dflt;
+	os<<"generic derivation "<<gen_der<<endl;
+	os<<"derivation when the following are zero: "<<context.derivation_when(context.der().GenericElement())<<endl;
+	os<<latex;
+	return gen_der;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <sys/resource.h>
+
+/** Measurements taken while studying a Lie algebra, cheap enough to be always collected */
+struct StudyTelemetry {
+	std::vector<std::pair<std::string,double>> stage_seconds;	///< the wall-clock time spent in each stage, in the order the stages were run
+	long peak_rss_kilobytes=0;		///< the peak resident set size of the process that carried out the study, from the start of the study, @sa reset_peak_rss
+	long expression_nodes=0;		///< the number of nodes in the symbolic expressions making up the results
+/** Return the total time spent in the stages, in seconds */
+	double seconds() const {
+		double result=0;
+		for (auto& stage: stage_seconds) result+=stage.second;
+		return result;
+	}
+};
+
+/** A stopwatch that charges the time elapsed since the previous lap to a stage */
+class Stopwatch {
+	using Clock=std::chrono::steady_clock;
+	StudyTelemetry& telemetry;
+	Clock::time_point last=Clock::now();
+public:
+	explicit Stopwatch(StudyTelemetry& telemetry) : telemetry{telemetry} {}
+/** Charge the time elapsed since the previous lap, or since the stopwatch was created, to a stage */
+	void lap(const std::string& stage) {
+		auto now=Clock::now();
+		telemetry.stage_seconds.emplace_back(stage,std::chrono::duration<double>(now-last).count());
+		last=now;
+	}
+};
+
+/** Reset the peak resident set size of the calling process to its current resident set size, so that peak_rss_kilobytes measures the memory used from this point on
+
+	This has no effect where /proc/self/clear_refs does not accept the value 5 (Linux 4.0 and later do).
+*/
+inline void reset_peak_rss() {
+	std::ofstream{"/proc/self/clear_refs"}<<"5"<<std::flush;
+}
+
+/** Return the peak resident set size of the calling process in kilobytes, since the last call to reset_peak_rss
+
+	The value is read from VmHWM in /proc/self/status. Where this is not available, it is the peak since the process started as returned by getrusage, which in a forked process includes the memory used by the parent before the fork, and is then an upper bound.
+*/
+inline long peak_rss_kilobytes() {
+	std::ifstream status{"/proc/self/status"};
+	std::string line;
+	while (getline(status,line))
+		if (line.compare(0,6,"VmHWM:")==0) {
+			long kilobytes;
+			if (std::stringstream{line.substr(6)}>>kilobytes) return kilobytes;
+		}
+	rusage usage{};
+	getrusage(RUSAGE_SELF,&usage);
+	return usage.ru_maxrss;
+}
+
+/** Return telemetry as text, one measurement per line, so that it can be passed from a worker process to the parent */
+inline std::string serialize(const StudyTelemetry& telemetry) {
+	std::stringstream s;
+	for (auto& stage: telemetry.stage_seconds) s<<"stage "<<stage.first<<' '<<stage.second<<'\n';
+	s<<"peak_rss_kilobytes "<<telemetry.peak_rss_kilobytes<<'\n';
+	s<<"expression_nodes "<<telemetry.expression_nodes<<'\n';
+	return s.str();
+}
+
+/** Read telemetry written by serialize; unknown or malformed lines are ignored */
+inline StudyTelemetry deserialize_telemetry(std::istream& is) {
+	StudyTelemetry telemetry;
+	std::string line;
+	while (getline(is,line)) {
+		std::stringstream s{line};
+		std::string key;
+		s>>key;
+		if (key=="stage") {
+			std::string stage;
+			double seconds;
+			if (s>>stage>>seconds) telemetry.stage_seconds.emplace_back(stage,seconds);
+		}
+		else if (key=="peak_rss_kilobytes") s>>telemetry.peak_rss_kilobytes;
+		else if (key=="expression_nodes") s>>telemetry.expression_nodes;
+	}
+	return telemetry;
+}
+
+#endif
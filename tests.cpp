@@ -0,0 +1,215 @@
+/*  Copyright (C) 2021 by Diego Conti, diego.conti@unimib.it
+
+    This file is part of Gleipnir
+
+    Gleipnir is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Gleipnir is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Gleipnir.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Tests of the parts of gleipnir that do not depend on GiNaC: deduplication, sharding, cost model and result store.
+
+	Each failed check is reported on standard error; the exit status is nonzero if any check failed.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+#include "fingerprint.h"
+#include "shard.h"
+#include "costmodel.h"
+#include "store.h"
+
+using namespace std;
+
+int failures=0;
+
+void check(bool condition, const string& what) {
+	if (condition) return;
+	cerr<<"FAILED: "<<what<<endl;
+	++failures;
+}
+
+/** Relabel the basis of a Lie algebra, mapping each e_i to e_{permutation[i]} */
+RationalStructureConstants permuted(const RationalStructureConstants& c, const vector<int>& permutation) {
+	RationalStructureConstants result;
+	result.n=c.n;
+	for (auto& [i,j,k,value]: c.components) {
+		int pi=permutation[i], pj=permutation[j], pk=permutation[k];
+		if (pi<pj) result.components.emplace_back(pi,pj,pk,value);
+		else result.components.emplace_back(pj,pi,pk,-value);
+	}
+	sort(result.components.begin(),result.components.end());
+	return result;
+}
+
+/** Return structure constants in the format of StructureConstants::normal_form */
+string normal_form(const RationalStructureConstants& c) {
+	stringstream s;
+	s<<c.n;
+	for (auto& [i,j,k,value]: c.components) s<<';'<<i+1<<','<<j+1<<','<<k+1<<':'<<value.get_str();
+	return s.str();
+}
+
+/** The seven-dimensional nilpotent Lie algebra 0,0,12,13,23,14+25,15+2*34, in normal form */
+const string lie_algebra="7;1,2,3:1;1,3,4:1;1,4,6:1;1,5,7:1;2,3,5:1;2,5,6:1;3,4,7:2";
+
+const vector<vector<int>> permutations={{0,1,2,3,4,5,6},{6,5,4,3,2,1,0},{1,0,2,3,4,5,6},{3,6,0,5,1,4,2},{2,4,6,1,3,5,0}};
+
+void test_canonical_relabeling() {
+	auto c=parse_normal_form(lie_algebra);
+	check(c.has_value(),"parse_normal_form reads a normal form");
+	check(normal_form(*c)==lie_algebra,"normal_form inverts parse_normal_form");
+	check(!parse_normal_form("7;1,2,3:lambda"),"parse_normal_form rejects parameters");
+	auto canonical=canonical_relabeling(*c);
+	check(canonical.has_value(),"canonical_relabeling handles dimension 7");
+	check(normal_form(permuted(*c,canonical->permutation))==canonical->canonical_form,"the permutation of canonical_relabeling gives the canonical form");
+	for (auto& permutation: permutations) {
+		auto relabeled=canonical_relabeling(permuted(*c,permutation));
+		check(relabeled && relabeled->canonical_form==canonical->canonical_form,"canonical_relabeling is invariant under permutations");
+	}
+	auto rescaled=parse_normal_form("7;1,2,3:1;1,3,4:1;1,4,6:1;1,5,7:1;2,3,5:1;2,5,6:1;3,4,7:3");
+	check(canonical_relabeling(*rescaled)->canonical_form!=canonical->canonical_form,"canonical_relabeling distinguishes Lie algebras not related by a permutation");
+	RationalStructureConstants large;
+	large.n=max_relabeling_dimension+1;
+	check(!canonical_relabeling(large),"canonical_relabeling gives up above max_relabeling_dimension");
+}
+
+void test_deduplicator() {
+	auto c=*parse_normal_form(lie_algebra);
+	Deduplicator known;
+	auto first=known.add("first",lie_algebra,true);
+	check(!first.duplicate && !first.same_invariants_as && first.fingerprint,"a new Lie algebra is not a duplicate");
+	auto identical=known.compare(lie_algebra);
+	check(identical.duplicate && identical.duplicate->of=="first" && identical.duplicate->relabeling.empty() && identical.duplicate->stored,"identical structure constants are recognized");
+	for (auto& permutation: permutations) {
+		auto relabeled=permuted(c,permutation);
+		auto outcome=known.compare(normal_form(relabeled));
+		if (normal_form(relabeled)==lie_algebra) continue;
+		check(outcome.duplicate && outcome.duplicate->of=="first","a permuted Lie algebra is recognized");
+		if (!outcome.duplicate) continue;
+		check(normal_form(permuted(relabeled,outcome.duplicate->relabeling))==lie_algebra,"the reported relabeling maps a duplicate to the Lie algebra seen before");
+	}
+	auto other="7;1,2,3:1;1,3,4:1;1,4,6:1;1,5,7:1;2,3,5:1;2,5,6:1;3,4,7:3";
+	auto outcome=known.compare(other);
+	check(!outcome.duplicate && outcome.same_invariants_as==string{"first"},"a Lie algebra with the same fingerprint is reported, but not as a duplicate");
+	check(!known.compare(other).duplicate,"compare does not add");
+	known.add("second",other);
+	check(known.compare(other).duplicate->of=="second","add registers Lie algebras that are not duplicates");
+	auto parametric=known.add("parametric","7;1,2,3:lambda");
+	check(!parametric.fingerprint && !parametric.duplicate,"Lie algebras with parameters have no fingerprint");
+	check(known.compare("7;1,2,3:lambda").duplicate->of=="parametric","Lie algebras with parameters are recognized if identical");
+}
+
+void test_shard_tasks() {
+	vector<double> costs;
+	for (int i=0;i<100;++i) costs.push_back((i*37)%11+(i%7==0? 100 : 0));
+	for (int count=1;count<=5;++count) {
+		vector<int> assigned(costs.size());
+		vector<double> load(count);
+		for (int index=1;index<=count;++index) {
+			auto tasks=shard_tasks(costs,Shard{index,count});
+			check(is_sorted(tasks.begin(),tasks.end()),"shard_tasks returns positions in increasing order");
+			check(tasks==shard_tasks(costs,Shard{index,count}),"shard_tasks is deterministic");
+			for (int i: tasks) {
+				++assigned[i];
+				load[index-1]+=costs[i];
+			}
+		}
+		check(all_of(assigned.begin(),assigned.end(),[] (int x) {return x==1;}),"shards are disjoint and cover all tasks");
+		check(*max_element(load.begin(),load.end())-*min_element(load.begin(),load.end())<=*max_element(costs.begin(),costs.end()),"shards are balanced");
+	}
+	check(shard_tasks({},Shard{2,3}).empty(),"shard_tasks accepts no tasks");
+	auto shard=parse_shard("2/3");
+	check(shard.index==2 && shard.count==3,"parse_shard reads i/N");
+	for (auto invalid: {"0/3","4/3","2","2/","/3","2/3x"}) {
+		bool thrown=false;
+		try {parse_shard(invalid);}
+		catch (const invalid_argument&) {thrown=true;}
+		check(thrown,string{"parse_shard rejects "}+invalid);
+	}
+	check(described_dimension("0,0,12,13,[f(a,b)]*14+23; a,b")==5,"described_dimension ignores commas in brackets");
+	check(estimated_cost("0,0,12,13,[lambda]*14+23; lambda")>estimated_cost("0,0,12,13,14+23"),"parameters increase the estimated cost");
+}
+
+void test_cost_model(const string& directory) {
+	auto path=directory+"/timings";
+	{
+		CostModel model{path};
+		model.record("0,0,12",2);
+		model.record("0,0,12,13",8);
+		check(model.cost("0,0,12")==2,"recorded times are used");
+	}
+	{
+		ofstream{path,ios::app}<<"not a time\n";
+		CostModel model{path};
+		check(model.cost("0,0,12,13")==8,"recorded times are read back, ignoring malformed lines");
+		double seconds_per_unit=10/(estimated_cost("0,0,12")+estimated_cost("0,0,12,13"));
+		check(abs(model.cost("0,0,12,13,14")-seconds_per_unit*estimated_cost("0,0,12,13,14"))<1e-9,"estimates are rescaled to the recorded times");
+	}
+}
+
+void test_result_store(const string& directory) {
+	auto path=directory+"/results.store";
+	StudyRecord first, second;
+	first.structure_constants="3;1,2,3:1";
+	first.output="first\n";
+	first.derivation_basis=string{"with\0null",9};
+	second.structure_constants="3;1,2,3:1";
+	second.output="second\n";
+	{
+		ResultStore store{path};
+		store.append("h",first);
+		store.append("r",second);
+		store.append("h",second);
+	}
+	{
+		ofstream{path+".index",ios::app}<<"truncated\t1";
+	}
+	ResultStore store{path};
+	check(store.names()==vector<string>{"h","r"},"names lists the stored Lie algebras, ignoring malformed index lines");
+	auto record=store.load("h");
+	check(record && record->output=="second\n","the last record of a Lie algebra prevails");
+	record=store.load("r");
+	check(record && fields(*record).size()==fields(second).size(),"records are read back");
+	if (record)
+		for (int i=0;i<fields(second).size();++i)
+			check(*fields(*record)[i].second==*fields(second)[i].second,string{"field "}+fields(second)[i].first+" is read back");
+	check(!store.load("missing"),"missing Lie algebras are not found");
+	check(store.structure_constants("r")==second.structure_constants,"structure constants are read from the index");
+	store.append("after",first);
+	ResultStore reopened{path};
+	check(reopened.load("after") && reopened.load("after")->derivation_basis==first.derivation_basis,"records appended after a truncated index line are read back");
+	ofstream{directory+"/other.store"}<<"something else\n";
+	bool thrown=false;
+	try {ResultStore other{directory+"/other.store"};}
+	catch (const runtime_error&) {thrown=true;}
+	check(thrown,"files that are not stores are rejected");
+}
+
+int main() {
+	char directory[]="/tmp/gleipnir_tests.XXXXXX";
+	if (!mkdtemp(directory)) {
+		cerr<<"cannot create a temporary directory"<<endl;
+		return 1;
+	}
+	test_canonical_relabeling();
+	test_deduplicator();
+	test_shard_tasks();
+	test_cost_model(directory);
+	test_result_store(directory);
+	for (auto file: {"timings","results.store","results.store.index","other.store"}) unlink((string{directory}+"/"+file).c_str());
+	rmdir(directory);
+	if (failures) cerr<<failures<<" checks failed"<<endl;
+	return failures? 1 : 0;
+}